@@ -0,0 +1,77 @@
+#ifndef BTREE_INDEX_H
+#define BTREE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// In-memory B+tree keyed by record ID. Every node keeps its keys in one
+// contiguous array, so a search inside a node reads a few cache lines, and
+// leaves are chained in key order for range scans. Keys are unique.
+#define BTREE_INDEX_MAX_KEYS 32
+
+// Nodes other than the root never drop below half full. Leaves hold at
+// least this many keys, inner nodes one fewer.
+#define BTREE_INDEX_MIN_KEYS (BTREE_INDEX_MAX_KEYS / 2)
+
+typedef struct BTreeNode {
+    bool leaf;
+    int count;                  // Keys in use
+    int keys[BTREE_INDEX_MAX_KEYS];
+    union {
+        uintptr_t values[BTREE_INDEX_MAX_KEYS];                 // Leaf: record handles
+        struct BTreeNode *children[BTREE_INDEX_MAX_KEYS + 1];   // Inner: subtrees
+    };
+    struct BTreeNode *next;     // Leaf: the next leaf in key order
+} BTreeNode;
+
+typedef struct {
+    int key;
+    uintptr_t value;
+} BTreeEntry;
+
+typedef struct {
+    BTreeNode *root;            // Always a node, an empty tree is one empty leaf
+    size_t count;               // Keys in all leaves
+    int height;                 // Levels, 1 when the root is a leaf
+    BTreeEntry *staged;         // Bulk load buffer, NULL outside a bulk load
+    size_t stagedCount;
+    size_t stagedCapacity;
+} BTreeIndex;
+
+// Range iteration state, set up by btreeIndexSeek
+typedef struct {
+    const BTreeNode *leaf;
+    int position;
+    int last;                   // Highest key to return
+    int key;
+    uintptr_t value;
+} BTreeCursor;
+
+// Lifecycle
+bool btreeIndexInit(BTreeIndex *index);
+void btreeIndexFree(BTreeIndex *index);
+
+// Insert fails when the key is already present or memory runs out; the tree
+// is left valid either way. Remove returns false for a missing key.
+bool btreeIndexInsert(BTreeIndex *index, int key, uintptr_t value);
+bool btreeIndexRemove(BTreeIndex *index, int key);
+
+// Bulk loading: between begin and end, inserts only append to a buffer.
+// End sorts it once and builds the tree bottom-up with full leaves, so
+// loading n keys costs one sort instead of n descents. The tree must be
+// empty when the load begins and lookups do not see staged keys. End fails
+// when a key repeats or memory runs out, leaving the tree empty.
+void btreeIndexBeginBulk(BTreeIndex *index);
+bool btreeIndexEndBulk(BTreeIndex *index);
+
+// Lookups only read, so they are safe under a shared lock.
+// value may be NULL when only presence matters.
+bool btreeIndexFind(const BTreeIndex *index, int key, uintptr_t *value);
+
+// Visits the keys in [first, last] in ascending order. The tree must not
+// change while a cursor is in use.
+void btreeIndexSeek(const BTreeIndex *index, int first, int last, BTreeCursor *cursor);
+bool btreeIndexNext(BTreeCursor *cursor);
+
+#endif /* BTREE_INDEX_H */
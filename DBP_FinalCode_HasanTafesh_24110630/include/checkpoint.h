@@ -0,0 +1,19 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+
+// A checkpoint runs when this much time has passed or this much log was
+// written since the last one, whichever comes first
+#define CHECKPOINT_INTERVAL_SECONDS 60
+#define CHECKPOINT_LOG_BYTES (4 * 1024 * 1024)
+
+// Background checkpointer
+void checkpointStart();
+void checkpointStop();
+bool checkpointRun();
+
+// Display operations
+void showCheckpointStatistics();
+
+#endif /* CHECKPOINT_H */
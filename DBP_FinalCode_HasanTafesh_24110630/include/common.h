@@ -4,13 +4,16 @@
 #include <stdbool.h>
 
 // Common size definitions
-#define HASH_TABLE_SIZE 100  
-#define NAME_MAPPING_SIZE 100  
+#define HASH_TABLE_SIZE 100     // Initial capacity of the ID indexes and arrays
+#define NAME_SUGGESTION_LIMIT 10 // Matches listed by the name prefix searches
 
-extern int hashTableSize; 
-
-// Hash function
-int hash(int key);
+// Table identifiers shared by the lock table and the write-ahead log
+#define STUDENT_TABLE_ID 1
+#define COURSE_TABLE_ID 2
+#define DEPARTMENT_TABLE_ID 3
+#define ENROLLMENT_TABLE_ID 4
+#define INSTRUCTOR_TABLE_ID 5
+#define INSTRUCTOR_PHONE_TABLE_ID 6
 
 // Common validation functions for department and instructor since they are used in multiple modules
 bool validateDepartmentReference(int departmentId);
@@ -5,9 +5,12 @@
 #include "department.h"
 #include "instructor.h"
 #include "common.h"
+#include "hash_index.h"
+#include "btree_index.h"
+#include "ref_index.h"
+#include "prefix_index.h"
 
 #define HASH_TABLE_SIZE 100
-#define NAME_MAPPING_SIZE 100
 
 typedef struct Course {
     int id;                     
@@ -18,24 +21,18 @@ typedef struct Course {
     int occupied;              // Flag for hash table slot occupation
 } Course;
 
-typedef struct {
-    char title[100];           // For searcheaing using the title
-    int id;                    
-} CourseTitleIdMapping;
-
-typedef struct {
-    Course *course;            // For thread operations
-} CourseThreadArg;
-
-// Hash table and mapping declarations
-extern Course **courseHashTable;
-extern CourseTitleIdMapping courseTitleMapping[NAME_MAPPING_SIZE];
-extern int courseMappingCount;
+// Hash index and array declarations
+extern HashIndex courseIndex;
+extern RefIndex coursesByDepartment;
+extern RefIndex coursesByInstructor;
+extern HashIndex courseTitleIndex;
+extern PrefixIndex courseTitlePrefixIndex;
 extern int courseCounter;
-extern int *courseIdArray;
+extern BTreeIndex courseIdTree;
 
 // Core operations
 void initCourses();
+void checkCourseReferences();
 void insertCourse(Course *course, bool isInit);
 void updateCourse(int id, int instructorId);
 void deleteCourse(int id);
@@ -44,12 +41,14 @@ void deleteCourse(int id);
 Course *searchCourseById(int id);
 Course *searchCourseByTitle(char title[]);
 void searchCoursesByDepartment(int departmentId);
+int searchCoursesByTitlePrefix(char prefix[], Course *results[], int limit);
 
 // Display operations
 void showCourse(Course *course);
 void showAllCourses();
 void showEnrolledStudents(int courseId);
 void showCourseDetails(int courseId);
+void showCourseTitleSuggestions(char prefix[]);
 
 // Menu operations
 Course *selectCourseMenu();
@@ -3,9 +3,11 @@
 
 #include <stdbool.h>
 #include "common.h"
+#include "hash_index.h"
+#include "btree_index.h"
+#include "prefix_index.h"
 
 #define HASH_TABLE_SIZE 100
-#define NAME_MAPPING_SIZE 100
 
 typedef struct Department {
     int id;                     
@@ -14,21 +16,12 @@ typedef struct Department {
     int occupied;               // Flag for hash table slot occupation
 } Department;
 
-typedef struct {
-    char name[100];             // For search using name 
-    int id;                    
-} DepartmentNameIdMapping;
-
-typedef struct {
-    Department *department;     // For thread operations
-} DepartmentThreadArg;
-
-// Hash table and mapping declarations
-extern Department **departmentHashTable;
-extern DepartmentNameIdMapping departmentNameMapping[NAME_MAPPING_SIZE];
-extern int departmentMappingCount;
+// Hash index and array declarations
+extern HashIndex departmentIndex;
+extern HashIndex departmentNameIndex;
+extern PrefixIndex departmentNamePrefixIndex;
 extern int departmentCounter;
-extern int *departmentIdArray;
+extern BTreeIndex departmentIdTree;
 
 // Core operations
 void initDepartments();
@@ -41,6 +34,7 @@ void deleteDepartment(int id);
 Department *searchDepartmentById(int id);
 Department *searchDepartmentByName(char name[]);
 Department *searchDepartmentByPhone(char phone[]);
+int searchDepartmentsByNamePrefix(char prefix[], Department *results[], int limit);
 
 // Display operations
 void showDepartment(Department *dept);
@@ -48,6 +42,7 @@ void showAllDepartments();
 void showInstructorsInDepartment(int departmentId);
 void showCoursesInDepartment(int departmentId);
 void showStudentsInDepartment(int departmentId);
+void showDepartmentNameSuggestions(char prefix[]);
 
 // Menu operations
 Department *selectDepartmentMenu();
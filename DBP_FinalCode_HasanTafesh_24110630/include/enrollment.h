@@ -5,6 +5,9 @@
 #include "student.h"
 #include "course.h"
 #include "common.h"
+#include "hash_index.h"
+#include "btree_index.h"
+#include "ref_index.h"
 
 #define HASH_TABLE_SIZE 100
 #define MAX_GRADE_LENGTH 2
@@ -25,17 +28,17 @@ typedef struct Enrollment {
     int occupied;               // Flag for hash table slot occupation
 } Enrollment;
 
-typedef struct {
-    Enrollment *enrollment;     // For thread operations
-} EnrollmentThreadArg;
-
-// Hash table and array declarations
-extern Enrollment **enrollmentHashTable; 
+// Hash index and array declarations
+extern HashIndex enrollmentIndex;
+extern HashIndex enrollmentPairIndex;
+extern RefIndex enrollmentsByStudent;
+extern RefIndex enrollmentsByCourse;
 extern int enrollmentCounter;
-extern int *enrollmentIdArray;
+extern BTreeIndex enrollmentIdTree;
 
 // Core operations
 void initEnrollments();
+void checkEnrollmentReferences();
 void storeEnrollment(Enrollment *enrollment);
 void insertEnrollment(Enrollment *enrollment, bool isInit);
 void updateGrade(int enrollmentId, char grade[]);
@@ -0,0 +1,91 @@
+#ifndef HASH_INDEX_H
+#define HASH_INDEX_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Open addressing hash index in the style of a Swiss table. A separate array
+// of one byte control words (empty, deleted or the low 7 bits of the hash)
+// is probed 16 slots at a time, so a lookup only touches the keys whose hash
+// fragment matches. Keys and record handles are stored inline.
+#define HASH_INDEX_GROUP_WIDTH 16
+#define HASH_INDEX_MIN_CAPACITY 16
+
+// Growing does not rehash everything at once. The old slot array is kept next
+// to the new one and every insert or remove moves at least this many old
+// slots over.
+#define HASH_INDEX_MIGRATE_STEP 64
+
+// Once deleted slots make up this share of the table it is rebuilt, shrinking
+// it when the live entries fit in a smaller one
+#define HASH_INDEX_MAX_TOMBSTONE_PERCENT 25
+
+typedef struct {
+    int8_t *ctrl;               // capacity + HASH_INDEX_GROUP_WIDTH control bytes, the tail mirrors the head
+    uint64_t *keys;
+    uintptr_t *values;          // Record handles
+    size_t capacity;            // Power of two
+    size_t tombstones;          // Deleted slots not reused yet
+    size_t growthLeft;          // Empty slots that may still be filled before a rehash
+} HashIndexTable;
+
+typedef struct {
+    HashIndexTable current;     // New entries always go here
+    HashIndexTable old;         // Table being migrated, capacity 0 when none
+    size_t migrated;            // Old slots already moved to current
+    size_t migrateStep;         // Old slots moved per insert or remove
+    size_t count;               // Live entries in both tables
+} HashIndex;
+
+typedef struct {
+    size_t entries;
+    size_t capacity;            // Slots in both tables
+    size_t tombstones;
+    double averageProbe;        // Groups probed to find a live entry
+} HashIndexStats;
+
+// Iteration state, start with {0}
+typedef struct {
+    size_t position;
+    uint64_t key;
+    uintptr_t value;
+} HashIndexCursor;
+
+// Tells apart entries that share a key, e.g. records whose strings hash alike
+typedef bool (*HashIndexMatch)(uintptr_t value, const void *ctx);
+
+// Lifecycle
+bool hashIndexInit(HashIndex *index, size_t expected);
+void hashIndexFree(HashIndex *index);
+bool hashIndexReserve(HashIndex *index, size_t expected);
+
+// Entry operations, the index does not check keys for uniqueness.
+// Find only reads, so it is safe under a shared lock.
+bool hashIndexInsert(HashIndex *index, uint64_t key, uintptr_t value);
+bool hashIndexFind(const HashIndex *index, uint64_t key, uintptr_t *value);
+bool hashIndexRemove(HashIndex *index, uint64_t key, uintptr_t value);
+
+// String columns are indexed by a 64-bit hash of the text. Lookups pass a
+// match that compares the record's column, so colliding strings are skipped.
+uint64_t hashIndexStringKey(const char *text);
+bool hashIndexFindMatch(const HashIndex *index, uint64_t key, HashIndexMatch match, const void *ctx,
+                        uintptr_t *value);
+
+// Visits every live entry once, the index must not change in between
+bool hashIndexNext(const HashIndex *index, HashIndexCursor *cursor);
+
+// Occupancy and probe statistics, walks the whole index
+void hashIndexGetStats(const HashIndex *index, HashIndexStats *stats);
+
+// Snapshot images. An image is the slot arrays as they are, so loading one
+// costs a copy instead of a hash and probe per entry. Values are written as
+// 32-bit record ordinals rather than handles; loading maps ordinal i back
+// to handles[i]. Load returns the bytes read, 0 when the image is damaged
+// and the index was left as it was.
+bool hashIndexWriteImage(const HashIndex *index, FILE *file);
+size_t hashIndexLoadImage(HashIndex *index, const unsigned char *image, size_t size,
+                          const uintptr_t *handles, size_t handleCount);
+
+#endif /* HASH_INDEX_H */
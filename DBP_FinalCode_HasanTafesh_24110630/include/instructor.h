@@ -4,8 +4,11 @@
 #include <stdbool.h>
 #include "department.h"
 #include "common.h"
+#include "hash_index.h"
+#include "btree_index.h"
+#include "ref_index.h"
+#include "prefix_index.h"
 
-#define NAME_MAPPING_SIZE 100
 #define MAX_PHONE_NUMBERS 3
 
 // Structs for instructor and phone numbers
@@ -24,27 +27,20 @@ typedef struct Instructor {
     int occupied;              // Flag for hash table slot occupation
 } Instructor;
 
-typedef struct {
-    char firstName[50];         // For name-based search
-    char lastName[50];          // Last name
-    int id;                    // Corresponding instructor ID
-} InstructorNameIdMapping;
-
-typedef struct {
-    Instructor *instructor;     // For thread operations
-} InstructorThreadArg;
-
 
 
-extern Instructor **instructorHashTable; // Declare the instructor hash table
-extern InstructorNameIdMapping instructorNameMapping[NAME_MAPPING_SIZE];
-extern int instructorMappingCount;
+extern HashIndex instructorIndex;
+extern RefIndex instructorsByDepartment;
+extern HashIndex instructorNameIndex;
+extern PrefixIndex instructorNamePrefixIndex;
 extern int instructorCounter;
-extern int *instructorIdArray;
+extern int phoneNumberCapacity;
+extern BTreeIndex instructorIdTree;
 
 // Core operations
 void initInstructors();
-void storeInstructor(Instructor *inst);
+void checkInstructorReferences();
+bool storeInstructor(Instructor *inst);
 void insertInstructor(Instructor *inst, bool isInit);
 void updateInstructor(int id, char *email);
 void deleteInstructor(int id);
@@ -53,18 +49,20 @@ void deleteInstructor(int id);
 void addInstructorPhoneNumber(int instructorId, char phone[]);
 void removeInstructorPhoneNumber(int phoneNumberId);
 void showInstructorPhoneNumbers(int instructorId);
-void storeInstructorPhoneNumber(InstructorPhoneNumber *phone);
+bool storeInstructorPhoneNumber(InstructorPhoneNumber *phone);
 
 // Search operations
 Instructor *searchInstructorById(int id);
 Instructor *searchInstructorByName(char firstName[], char lastName[]);
 Instructor *searchInstructorByEmail(char email[]);
 void searchInstructorsByDepartment(int departmentId);
+int searchInstructorsByNamePrefix(char prefix[], Instructor *results[], int limit);
 
 // Display operations
 void showInstructor(Instructor *inst);
 void showAllInstructors();
 void showInstructorCourses(int instructorId);
+void showInstructorNameSuggestions(char prefix[]);
 
 // Menu operations
 void instructorMenu();
@@ -0,0 +1,9 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+// Startup loading. Every table is read on its own thread while a shared
+// pool reads page ranges and parses text ranges for all of them. Foreign
+// keys are checked in one pass once every table is in memory.
+void loadAllTables();
+
+#endif /* LOADER_H */
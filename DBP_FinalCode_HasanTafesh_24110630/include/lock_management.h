@@ -2,12 +2,60 @@
 #ifndef LOCK_MANAGEMENT_H
 #define LOCK_MANAGEMENT_H
 
+#include <stdbool.h>
 #include <pthread.h>
 
-typedef enum { NONE, SHARED, EXCLUSIVE } LockType;
+// Locks form a hierarchy: a table, then its rows. Before locking a row a
+// thread takes the table in an intention mode, INTENTION_SHARED to read the
+// row and INTENTION_EXCLUSIVE to change it. Row lockers share the table in
+// those modes while SHARED and EXCLUSIVE table locks keep them out.
+// SHARED_INTENTION_EXCLUSIVE reads the whole table and lets only its holder
+// change rows, others may still read single rows.
+typedef enum {
+    NONE, SHARED, EXCLUSIVE, INTENTION_SHARED, INTENTION_EXCLUSIVE, SHARED_INTENTION_EXCLUSIVE
+} LockType;
+
+// Row locks live in a hash table keyed by (table, row), created on first use
+// and freed once nobody holds or waits for them
+#define LOCK_BUCKETS 1024
+
+// How long a row lock request waits before giving up, 0 waits forever
+#define LOCK_DEFAULT_TIMEOUT_MS 5000
+
+// How often the deadlock detector looks for cycles among waiting threads
+#define DEADLOCK_CHECK_MS 100
 
 void initialize_lock_table();
+void set_lock_timeout(int milliseconds);
+
+// Background deadlock detector. It builds the waits-for graph of the
+// threads blocked on locks, and for each cycle aborts the abortable request
+// whose thread holds the fewest locks, the most recent one on a tie.
+void start_deadlock_detector();
+void stop_deadlock_detector();
+
+// Whole table locks, for scans and for anything that changes an index.
+// These wait as long as it takes, so they are only taken while no other
+// lock is held and can never close a deadlock.
 void acquire_lock(int table_id, LockType lock_type);
 void release_lock(int table_id, LockType lock_type);
 
+// A table lock taken while other locks are held. It waits like acquire_lock
+// but returns false when it was aborted to break a deadlock.
+bool acquire_lock_abortable(int table_id, LockType lock_type);
+
+// Converts a held table lock to a stronger one, ahead of queued requests.
+// Returns false when it was aborted to break a deadlock, held_lock is still
+// held then.
+bool upgrade_lock(int table_id, LockType held_lock, LockType lock_type);
+
+// Row locks, SHARED or EXCLUSIVE, including the table's intention lock.
+// Returns false when the lock timed out or was aborted to break a deadlock,
+// nothing is held then.
+bool acquire_row_lock(int table_id, int row_id, LockType lock_type);
+void release_row_lock(int table_id, int row_id, LockType lock_type);
+
+// Display operations
+void show_lock_statistics();
+
 #endif
@@ -0,0 +1,44 @@
+#ifndef PREFIX_INDEX_H
+#define PREFIX_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Ordered string index for prefix searches. Keys are stored lower-cased in
+// sorted blocks of up to PREFIX_INDEX_BLOCK_SIZE entries; a full block is
+// split in two, so an insert only shifts entries inside one block. A search
+// binary-searches the blocks and reads matches in key order.
+#define PREFIX_INDEX_BLOCK_SIZE 256
+
+typedef struct {
+    char *key;                  // Lower-cased copy owned by the index
+    uintptr_t value;            // Record handle
+} PrefixEntry;
+
+typedef struct {
+    size_t count;
+    PrefixEntry entries[PREFIX_INDEX_BLOCK_SIZE];
+} PrefixBlock;
+
+typedef struct {
+    PrefixBlock **blocks;       // Ordered by their keys, none of them empty
+    size_t blockCount;
+    size_t blockCapacity;
+    size_t count;               // Entries in all blocks
+} PrefixIndex;
+
+// Lifecycle
+void prefixIndexInit(PrefixIndex *index);
+void prefixIndexFree(PrefixIndex *index);
+
+// Keys may repeat, remove takes the entry holding both key and value
+bool prefixIndexInsert(PrefixIndex *index, const char *key, uintptr_t value);
+bool prefixIndexRemove(PrefixIndex *index, const char *key, uintptr_t value);
+
+// Copies the handles of up to limit keys starting with prefix (ignoring
+// case) into results, in key order, and returns how many were found.
+// Only reads, so it is safe under a shared lock.
+size_t prefixIndexSearch(const PrefixIndex *index, const char *prefix, uintptr_t *results, size_t limit);
+
+#endif /* PREFIX_INDEX_H */
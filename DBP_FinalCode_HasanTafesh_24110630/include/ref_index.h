@@ -0,0 +1,45 @@
+#ifndef REF_INDEX_H
+#define REF_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "hash_index.h"
+
+// Secondary index from a key that many records share (a foreign key) to the
+// handles of those records. Each key owns a growable array, so a lookup
+// costs one hash probe plus the rows it returns.
+#define REF_LIST_MIN_CAPACITY 4
+
+typedef struct {
+    uintptr_t *handles;         // Record handles, in no particular order
+    size_t count;
+    size_t capacity;
+} RefList;
+
+typedef struct {
+    HashIndex lists;            // Maps key to its RefList
+    size_t count;               // Handles over all keys
+} RefIndex;
+
+// Lifecycle
+bool refIndexInit(RefIndex *index, size_t expectedKeys);
+void refIndexFree(RefIndex *index);
+
+// A key's list is created by its first handle and freed with its last one
+bool refIndexAdd(RefIndex *index, uint64_t key, uintptr_t handle);
+bool refIndexRemove(RefIndex *index, uint64_t key, uintptr_t handle);
+
+// Lookups only read, so they are safe under a shared lock.
+// Find returns NULL when no record has the key.
+const RefList *refIndexFind(const RefIndex *index, uint64_t key);
+size_t refIndexCount(const RefIndex *index, uint64_t key);
+
+// Snapshot images, see hashIndexWriteImage. Handles are written as record
+// ordinals and mapped back through handles[] when an image is loaded into
+// an empty index. Load returns the bytes read, 0 when the image is damaged.
+bool refIndexWriteImage(const RefIndex *index, FILE *file);
+size_t refIndexLoadImage(RefIndex *index, const unsigned char *image, size_t size,
+                         const uintptr_t *handles, size_t handleCount);
+
+#endif /* REF_INDEX_H */
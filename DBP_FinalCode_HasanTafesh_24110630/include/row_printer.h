@@ -0,0 +1,22 @@
+#ifndef ROW_PRINTER_H
+#define ROW_PRINTER_H
+
+#include <stddef.h>
+#include "btree_index.h"
+
+// Listing of whole tables. The rows are cut into ranges that a fixed set of
+// pool workers format into buffers of their own; the buffers are written to
+// stdout in order, one write per range.
+#define ROW_PRINTER_RANGE_ROWS 4096
+#define ROW_PRINTER_RANGES_PER_THREAD 2
+#define ROW_PRINTER_BUFFER_SIZE (64 * 1024)
+
+// Formats one row like snprintf: returns the length of the whole text,
+// which may be more than size
+typedef int (*RowFormat)(char *buffer, size_t size, const void *row);
+
+// Prints every row of the tree in key order. The caller keeps the rows from
+// changing meanwhile, i.e. holds the table's lock.
+void printRows(const BTreeIndex *tree, RowFormat format);
+
+#endif /* ROW_PRINTER_H */
@@ -0,0 +1,137 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "hash_index.h"
+#include "ref_index.h"
+#include "thread_pool.h"
+
+// Page file layout: page 0 holds the StorageHeader, every other page is a
+// slotted data page. Records are the fixed-size in-memory structs and must
+// start with their int primary key.
+#define STORAGE_PAGE_SIZE 4096
+#define STORAGE_MAGIC 0x53424455u  // "UDBS"
+#define STORAGE_VERSION 1
+#define STORAGE_MAX_TABLES 8
+#define STORAGE_SLOT_LIVE 0x8000   // Slot flag, the low bits hold the record offset
+
+// Snapshot image (data/*.idx), written next to the page file at every
+// checkpoint: a StorageImageHeader tying it to that page file, then the
+// table's hash and reference indexes as they are laid out in memory. Record
+// handles are stored as ordinals in page file order, so the image does not
+// depend on where the records end up in memory.
+#define STORAGE_IMAGE_MAGIC 0x49424455u  // "UDBI"
+#define STORAGE_IMAGE_VERSION 1
+#define STORAGE_MAX_IMAGE_INDEXES 4
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pageSize;
+    uint32_t recordSize;
+    uint32_t pageCount;         // Including the header page
+    uint32_t recordCount;       // Live records in the file
+    uint32_t checkpointSegment; // First log segment needed to recover the table
+    uint64_t checkpointLsn;     // Log records up to this LSN are in the file
+} StorageHeader;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t recordCount;       // Must match the page file header
+    uint32_t pageCount;         // Must match the page file header
+    uint32_t indexCount;
+    uint64_t checkpointLsn;     // Must match the page file header
+} StorageImageHeader;
+
+typedef struct {
+    uint16_t slotCount;         // Entries in the slot directory
+    uint16_t liveCount;         // Slots holding a live record
+    uint16_t freeEnd;           // Records are packed downwards from the page end
+    uint16_t reserved;
+    uint16_t slots[];           // Record offsets, STORAGE_SLOT_LIVE when in use
+} PageHeader;
+
+typedef struct StorageTable {
+    int tableId;                // Identifies the table in the write-ahead log
+    const char *name;           // Table name used in messages
+    const char *dataPath;       // Binary page file
+    const char *textPath;       // Whitespace separated import/export file
+    size_t recordSize;
+    HashIndex *index;           // ID index for the statistics, NULL when the table has none
+
+    // Record codec for the text import/export path. Parsed lines may point
+    // into a mapped file and are not NUL terminated.
+    bool (*parseText)(const char *line, size_t length, void *record);
+    void (*formatText)(FILE *file, const void *record);
+    // Visits every live in-memory record, used for the text export
+    void (*forEachRecord)(void (*visit)(const void *record, void *ctx), void *ctx);
+    // Re-applies a logged change to the in-memory table during recovery
+    void (*redoLog)(int operation, const void *image);
+
+    // Snapshot image, NULL imagePath when the table has none. imageKey gives
+    // the key of a record in the index'th image index, counting the hash
+    // indexes first and the reference indexes after them.
+    const char *imagePath;
+    HashIndex *imageIndexes[STORAGE_MAX_IMAGE_INDEXES];
+    int imageIndexCount;
+    RefIndex *imageRefIndexes[STORAGE_MAX_IMAGE_INDEXES];
+    int imageRefIndexCount;
+    uint64_t (*imageKey)(int index, const void *record);
+
+    // Runtime state
+    FILE *file;
+    StorageHeader header;
+    unsigned char lastPage[STORAGE_PAGE_SIZE];  // Tail page while appending
+    bool imageCurrent;          // The snapshot image matches the page file
+} StorageTable;
+
+// How startup scans and text imports read their files. Mapped reads fall
+// back to buffered ones where mmap is unavailable or fails.
+typedef enum {
+    STORAGE_READ_BUFFERED,      // stdio reads into private buffers
+    STORAGE_READ_MAPPED,        // Read-only mapping, faulted in on demand (default)
+    STORAGE_READ_MAPPED_POPULATE  // Mapping prefaulted in one call where supported
+} StorageReadMode;
+
+// Table lifecycle
+bool storageOpen(StorageTable *table);
+void storageClose(StorageTable *table);
+void storageCloseAll();
+StorageTable *storageFindTable(int tableId);
+void storageLogPosition(uint32_t *segment, uint64_t *lsn);
+
+// Record operations. Scans and text imports hand their reads and parsing
+// to the pool set here, which the startup loader sets while it runs.
+void storageSetThreadPool(ThreadPool *pool);
+void storageSetReadMode(StorageReadMode mode);
+int storageScan(StorageTable *table, void (*visit)(const void *record, void *ctx), void *ctx);
+
+// Startup from the snapshot image. Every record is passed to adopt, which
+// copies it into the table and the indexes not in the image and returns the
+// copy; the image's indexes are then loaded pointing at those copies.
+// Returns false, having loaded nothing, when no image matches the page file.
+bool storageLoadImage(StorageTable *table, void *(*adopt)(const void *record));
+bool storageImagesOutdated();
+
+// Checkpointing
+bool storageCheckpoint(StorageTable *table, uint64_t lsn, uint32_t segment);
+bool storageCheckpointAll(uint64_t lsn, uint32_t segment);
+
+// Text import/export
+int storageImportText(StorageTable *table);
+int storageExportText(StorageTable *table);
+void storageExportAll();
+
+// Display operations
+void showStorageStatistics();
+void showIndexStatistics();
+
+// Menu operations
+void storageMenu();
+void syncPolicyMenu();
+
+#endif /* STORAGE_H */
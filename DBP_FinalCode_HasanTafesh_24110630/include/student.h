@@ -4,10 +4,13 @@
 #include <stdbool.h>
 #include "department.h"
 #include "common.h"
+#include "hash_index.h"
+#include "btree_index.h"
+#include "ref_index.h"
+#include "prefix_index.h"
 
 
 #define HASH_TABLE_SIZE 100  
-#define NAME_MAPPING_SIZE 100
 
 typedef struct Student {
     int id;                     // Primary key
@@ -19,25 +22,17 @@ typedef struct Student {
     int occupied;              // Flag for hash table slot occupation
 } Student;
 
-typedef struct {
-    char firstName[50];         // For name-based search
-    char lastName[50];
-    int id;                    // Corresponding student ID
-} StudentNameIdMapping;
-
-typedef struct {
-    Student *student;          // For thread operations
-} StudentThreadArg;
-
-// Hash table and mapping declarations
-extern Student **studentHashTable;  // Pointer for dynamic hash table
-extern StudentNameIdMapping studentNameMapping[NAME_MAPPING_SIZE];
-extern int studentMappingCount;
+// Hash index and array declarations
+extern HashIndex studentIndex;
+extern RefIndex studentsByDepartment;
+extern HashIndex studentNameIndex;
+extern PrefixIndex studentNamePrefixIndex;
 extern int studentCounter;
-extern int *studentIdArray;
+extern BTreeIndex studentIdTree;
 
 // Core operations
 void initStudents();
+void checkStudentReferences();
 void storeStudent(Student *student);
 void insertStudent(Student *student, bool isInit);
 void updateStudent(int id, char *phone);
@@ -49,12 +44,15 @@ Student *searchStudentByName(char firstName[], char lastName[]);
 Student *searchStudentByEmail(char email[]);
 Student *searchStudentByPhone(char phone[]);
 void searchStudentsByDepartment(int departmentId);
+int searchStudentsByNamePrefix(char prefix[], Student *results[], int limit);
 
 // Display operations
 void showStudent(Student *student);
 void showAllStudents();
 void showStudentCourses(int studentId);
 void showStudentGrades(int studentId);
+void showStudentNameSuggestions(char prefix[]);
+void showStudentsInIdRange(int firstId, int lastId);
 
 // Menu operations
 Student *selectStudentMenu();
@@ -0,0 +1,49 @@
+#ifndef TEXT_READER_H
+#define TEXT_READER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Buffered line reader for the text import files. The file is read in
+// large blocks and lines are found with memchr, then handed out in place:
+// no copy and no allocation per line. A line longer than the buffer grows
+// it, so lines have no length limit.
+#define TEXT_READER_BLOCK_SIZE (64 * 1024)
+
+typedef struct {
+    FILE *file;
+    char *buffer;
+    size_t capacity;
+    size_t start;               // First byte of the next line
+    size_t length;              // Bytes read into the buffer
+    long offset;                // File offset of buffer[0]
+    bool eof;
+} TextReader;
+
+// Whitespace separated fields of one line, consumed from the front
+typedef struct {
+    const char *next;
+    const char *end;
+} TextFields;
+
+// Reader lifecycle, reading starts at the file's current position
+bool textReaderInit(TextReader *reader, FILE *file);
+void textReaderFree(TextReader *reader);
+
+// The next line without its newline, NUL terminated in the buffer. It stays
+// valid until the following call. Returns false at the end of the file.
+bool textReaderNextLine(TextReader *reader, char **line, size_t *length);
+
+// File offset of the next line
+long textReaderOffset(const TextReader *reader);
+
+// Field parsing. Integers are read without the locale and fail on stray
+// characters or overflow. Strings are copied straight into the record
+// field and fail when they do not fit, instead of being cut.
+void textFieldsInit(TextFields *fields, const char *line, size_t length);
+bool textFieldInt(TextFields *fields, int *value);
+bool textFieldString(TextFields *fields, char *dest, size_t size);
+int textFieldsLeft(const TextFields *fields);
+
+#endif /* TEXT_READER_H */
@@ -0,0 +1,49 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+// Fixed set of worker threads fed from a FIFO task queue. Callers wait on a
+// TaskGroup holding only the tasks they submitted, so several threads can
+// share one pool without waiting on each other's work.
+#define THREAD_POOL_MAX_THREADS 64
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t done;        // Signalled when the last pending task finishes
+    int pending;
+} TaskGroup;
+
+typedef struct PoolTask {
+    void (*run)(void *arg);
+    void *arg;
+    TaskGroup *group;
+    struct PoolTask *next;
+} PoolTask;
+
+typedef struct {
+    pthread_t threads[THREAD_POOL_MAX_THREADS];
+    int threadCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t available;   // Signalled when a task is queued or the pool stops
+    PoolTask *head;
+    PoolTask *tail;
+    bool stopping;
+} ThreadPool;
+
+// Lifecycle. Free runs the tasks still queued, then joins the workers.
+int threadPoolDefaultSize();
+bool threadPoolInit(ThreadPool *pool, int threads);
+void threadPoolFree(ThreadPool *pool);
+
+// Queues run(arg) as part of group. Without a pool, or when the task cannot
+// be queued, it runs on the calling thread before this returns.
+void threadPoolSubmit(ThreadPool *pool, TaskGroup *group, void (*run)(void *arg), void *arg);
+
+// Task groups
+void taskGroupInit(TaskGroup *group);
+void taskGroupWait(TaskGroup *group);
+void taskGroupDestroy(TaskGroup *group);
+
+#endif /* THREAD_POOL_H */
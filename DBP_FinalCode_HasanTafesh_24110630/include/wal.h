@@ -0,0 +1,55 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "storage.h"
+
+// The log is split into numbered segments, a checkpoint starts a new one and
+// removes the segments that are covered by the table images
+#define WAL_SEGMENT_FORMAT "data/wal.%06u.log"
+
+#define WAL_DEFAULT_SYNC_INTERVAL_MS 10
+
+// When a commit is forced to disk
+typedef enum WalSyncPolicy {
+    WAL_SYNC_EVERY_COMMIT,      // walLog returns after fsync, commits are grouped
+    WAL_SYNC_INTERVAL,          // A flusher thread syncs every N ms
+    WAL_SYNC_OS                 // Written at commit, the OS decides when to sync
+} WalSyncPolicy;
+
+typedef enum WalOperation {
+    WAL_INSERT = 1,
+    WAL_UPDATE,
+    WAL_DELETE
+} WalOperation;
+
+// Every log record is this header followed by the before image (updates and
+// deletes) and the after image (inserts and updates).
+typedef struct {
+    uint32_t checksum;          // CRC-32 of the header and images, computed with this field zeroed
+    uint32_t length;            // Total record length in bytes
+    uint64_t lsn;               // Log sequence number
+    uint16_t tableId;           // Table the record belongs to
+    uint16_t operation;         // WalOperation
+    uint32_t beforeSize;        // Size of the before image, 0 if absent
+    uint32_t afterSize;         // Size of the after image, 0 if absent
+    uint32_t reserved;
+} WalRecordHeader;
+
+// Recovery and logging
+int walRecover();
+uint64_t walLog(StorageTable *table, WalOperation operation, const void *before, const void *after);
+void walClose();
+void walSetSyncPolicy(WalSyncPolicy policy, int intervalMs);
+
+// Checkpoint support
+bool walBeginCheckpoint(uint64_t *lsn, uint32_t *segment);
+bool walFlush();
+void walRemoveSegments(uint32_t segment);
+uint64_t walPendingBytes();
+
+// Display operations
+void showWalStatistics();
+
+#endif /* WAL_H */
@@ -0,0 +1,437 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/btree_index.h"
+
+static BTreeNode *newNode(bool leaf) {
+    BTreeNode *node = calloc(1, sizeof(BTreeNode));
+    if (node == NULL) {
+        printf("Error: Memory allocation failed for B+tree node.\n");
+        return NULL;
+    }
+    node->leaf = leaf;
+    return node;
+}
+
+static void freeNode(BTreeNode *node) {
+    if (!node->leaf) {
+        for (int i = 0; i <= node->count; i++) {
+            freeNode(node->children[i]);
+        }
+    }
+    free(node);
+}
+
+// First position whose key is >= key
+static int lowerBound(const BTreeNode *node, int key) {
+    int low = 0, high = node->count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (node->keys[mid] < key) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// Child of an inner node that covers key: keys equal to a separator live on
+// its right, because a separator is the first key of its right subtree
+static int childIndex(const BTreeNode *node, int key) {
+    int low = 0, high = node->count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (node->keys[mid] <= key) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+static int minKeys(const BTreeNode *node) {
+    return node->leaf ? BTREE_INDEX_MIN_KEYS : BTREE_INDEX_MIN_KEYS - 1;
+}
+
+static const BTreeNode *findLeaf(const BTreeIndex *index, int key) {
+    const BTreeNode *node = index->root;
+    while (!node->leaf) {
+        node = node->children[childIndex(node, key)];
+    }
+    return node;
+}
+
+bool btreeIndexInit(BTreeIndex *index) {
+    memset(index, 0, sizeof(BTreeIndex));
+    index->height = 1;
+    index->root = newNode(true);
+    return index->root != NULL;
+}
+
+void btreeIndexFree(BTreeIndex *index) {
+    if (index->root != NULL) {
+        freeNode(index->root);
+    }
+    free(index->staged);
+    memset(index, 0, sizeof(BTreeIndex));
+}
+
+bool btreeIndexFind(const BTreeIndex *index, int key, uintptr_t *value) {
+    const BTreeNode *leaf = findLeaf(index, key);
+    int position = lowerBound(leaf, key);
+    if (position == leaf->count || leaf->keys[position] != key) {
+        return false;
+    }
+    if (value != NULL) {
+        *value = leaf->values[position];
+    }
+    return true;
+}
+
+static bool stageEntry(BTreeIndex *index, int key, uintptr_t value) {
+    if (index->stagedCount == index->stagedCapacity) {
+        size_t capacity = index->stagedCapacity * 2;
+        BTreeEntry *staged = realloc(index->staged, capacity * sizeof(BTreeEntry));
+        if (staged == NULL) {
+            printf("Error: Memory allocation failed for B+tree bulk load.\n");
+            return false;
+        }
+        index->staged = staged;
+        index->stagedCapacity = capacity;
+    }
+    index->staged[index->stagedCount].key = key;
+    index->staged[index->stagedCount].value = value;
+    index->stagedCount++;
+    return true;
+}
+
+static int compareEntries(const void *a, const void *b) {
+    int left = ((const BTreeEntry *)a)->key;
+    int right = ((const BTreeEntry *)b)->key;
+    return (left > right) - (left < right);
+}
+
+void btreeIndexBeginBulk(BTreeIndex *index) {
+    index->staged = malloc(BTREE_INDEX_MAX_KEYS * sizeof(BTreeEntry));
+    index->stagedCount = 0;
+    index->stagedCapacity = index->staged != NULL ? BTREE_INDEX_MAX_KEYS : 0;
+    // Without a buffer the load just falls back to ordinary inserts
+}
+
+// Packs sorted, unique entries into a new tree. Nodes at each level share
+// the keys or children evenly, so none of them is less than half full.
+static bool buildTree(BTreeIndex *index, const BTreeEntry *entries, size_t count) {
+    size_t nodes = (count + BTREE_INDEX_MAX_KEYS - 1) / BTREE_INDEX_MAX_KEYS;
+    BTreeNode **level = malloc(nodes * sizeof(BTreeNode *));
+    int *lowest = malloc(nodes * sizeof(int));  // Smallest key under each node
+    if (level == NULL || lowest == NULL) {
+        free(level);
+        free(lowest);
+        return false;
+    }
+
+    size_t used = 0;
+    for (size_t i = 0; i < nodes; i++) {
+        BTreeNode *leaf = newNode(true);
+        if (leaf == NULL) {
+            for (size_t j = 0; j < i; j++) free(level[j]);
+            free(level);
+            free(lowest);
+            return false;
+        }
+        leaf->count = (int)(count / nodes + (i < count % nodes));
+        for (int k = 0; k < leaf->count; k++) {
+            leaf->keys[k] = entries[used + k].key;
+            leaf->values[k] = entries[used + k].value;
+        }
+        used += leaf->count;
+        if (i > 0) level[i - 1]->next = leaf;
+        level[i] = leaf;
+        lowest[i] = leaf->keys[0];
+    }
+
+    // Parents are written over the front of the same arrays, never ahead
+    // of the children still to be read
+    int height = 1;
+    while (nodes > 1) {
+        size_t parents = (nodes + BTREE_INDEX_MAX_KEYS) / (BTREE_INDEX_MAX_KEYS + 1);
+        size_t child = 0;
+        for (size_t p = 0; p < parents; p++) {
+            BTreeNode *parent = newNode(false);
+            if (parent == NULL) {
+                for (size_t j = 0; j < p; j++) freeNode(level[j]);
+                for (size_t j = child; j < nodes; j++) freeNode(level[j]);
+                free(level);
+                free(lowest);
+                return false;
+            }
+            int children = (int)(nodes / parents + (p < nodes % parents));
+            for (int k = 0; k < children; k++) {
+                parent->children[k] = level[child + k];
+                if (k > 0) parent->keys[k - 1] = lowest[child + k];
+            }
+            parent->count = children - 1;
+            int low = lowest[child];
+            child += children;
+            level[p] = parent;
+            lowest[p] = low;
+        }
+        nodes = parents;
+        height++;
+    }
+
+    freeNode(index->root);
+    index->root = level[0];
+    index->count = count;
+    index->height = height;
+    free(level);
+    free(lowest);
+    return true;
+}
+
+bool btreeIndexEndBulk(BTreeIndex *index) {
+    BTreeEntry *entries = index->staged;
+    size_t count = index->stagedCount;
+    index->staged = NULL;
+    index->stagedCount = 0;
+    index->stagedCapacity = 0;
+    if (entries == NULL || count == 0) {
+        free(entries);
+        return true;
+    }
+
+    qsort(entries, count, sizeof(BTreeEntry), compareEntries);
+    bool built = true;
+    for (size_t i = 1; i < count && built; i++) {
+        if (entries[i].key == entries[i - 1].key) {
+            printf("Error: Duplicate key %d in B+tree bulk load.\n", entries[i].key);
+            built = false;
+        }
+    }
+    if (built && !buildTree(index, entries, count)) {
+        printf("Error: Memory allocation failed for B+tree bulk load.\n");
+        built = false;
+    }
+    free(entries);
+    return built;
+}
+
+// Splits the full child at parent->children[i] in two and adds the
+// separator to parent, which must have room for it
+static bool splitChild(BTreeNode *parent, int i) {
+    BTreeNode *child = parent->children[i];
+    BTreeNode *right = newNode(child->leaf);
+    if (right == NULL) {
+        return false;
+    }
+
+    int separator;
+    int half = BTREE_INDEX_MAX_KEYS / 2;
+    if (child->leaf) {
+        // Leaves copy the first key of the right half up
+        right->count = child->count - half;
+        memcpy(right->keys, child->keys + half, right->count * sizeof(int));
+        memcpy(right->values, child->values + half, right->count * sizeof(uintptr_t));
+        child->count = half;
+        right->next = child->next;
+        child->next = right;
+        separator = right->keys[0];
+    } else {
+        // Inner nodes move the middle key up
+        separator = child->keys[half];
+        right->count = child->count - half - 1;
+        memcpy(right->keys, child->keys + half + 1, right->count * sizeof(int));
+        memcpy(right->children, child->children + half + 1, (right->count + 1) * sizeof(BTreeNode *));
+        child->count = half;
+    }
+
+    memmove(parent->keys + i + 1, parent->keys + i, (parent->count - i) * sizeof(int));
+    memmove(parent->children + i + 2, parent->children + i + 1, (parent->count - i) * sizeof(BTreeNode *));
+    parent->keys[i] = separator;
+    parent->children[i + 1] = right;
+    parent->count++;
+    return true;
+}
+
+bool btreeIndexInsert(BTreeIndex *index, int key, uintptr_t value) {
+    if (index->staged != NULL) {
+        return stageEntry(index, key, value);
+    }
+    if (btreeIndexFind(index, key, NULL)) {
+        return false;
+    }
+
+    // Full nodes are split on the way down, so a split never has to travel
+    // back up and a failed allocation leaves a valid tree behind
+    if (index->root->count == BTREE_INDEX_MAX_KEYS) {
+        BTreeNode *root = newNode(false);
+        if (root == NULL) {
+            return false;
+        }
+        root->children[0] = index->root;
+        if (!splitChild(root, 0)) {
+            free(root);
+            return false;
+        }
+        index->root = root;
+        index->height++;
+    }
+
+    BTreeNode *node = index->root;
+    while (!node->leaf) {
+        int i = childIndex(node, key);
+        if (node->children[i]->count == BTREE_INDEX_MAX_KEYS) {
+            if (!splitChild(node, i)) {
+                return false;
+            }
+            if (key >= node->keys[i]) {
+                i++;
+            }
+        }
+        node = node->children[i];
+    }
+
+    int position = lowerBound(node, key);
+    memmove(node->keys + position + 1, node->keys + position, (node->count - position) * sizeof(int));
+    memmove(node->values + position + 1, node->values + position, (node->count - position) * sizeof(uintptr_t));
+    node->keys[position] = key;
+    node->values[position] = value;
+    node->count++;
+    index->count++;
+    return true;
+}
+
+// Moves one key from the left sibling of parent->children[i] into it
+static void borrowFromLeft(BTreeNode *parent, int i) {
+    BTreeNode *child = parent->children[i];
+    BTreeNode *left = parent->children[i - 1];
+
+    memmove(child->keys + 1, child->keys, child->count * sizeof(int));
+    if (child->leaf) {
+        memmove(child->values + 1, child->values, child->count * sizeof(uintptr_t));
+        child->keys[0] = left->keys[left->count - 1];
+        child->values[0] = left->values[left->count - 1];
+        parent->keys[i - 1] = child->keys[0];
+    } else {
+        memmove(child->children + 1, child->children, (child->count + 1) * sizeof(BTreeNode *));
+        child->keys[0] = parent->keys[i - 1];
+        child->children[0] = left->children[left->count];
+        parent->keys[i - 1] = left->keys[left->count - 1];
+    }
+    left->count--;
+    child->count++;
+}
+
+// Moves one key from the right sibling of parent->children[i] into it
+static void borrowFromRight(BTreeNode *parent, int i) {
+    BTreeNode *child = parent->children[i];
+    BTreeNode *right = parent->children[i + 1];
+
+    if (child->leaf) {
+        child->keys[child->count] = right->keys[0];
+        child->values[child->count] = right->values[0];
+        memmove(right->values, right->values + 1, (right->count - 1) * sizeof(uintptr_t));
+        memmove(right->keys, right->keys + 1, (right->count - 1) * sizeof(int));
+        parent->keys[i] = right->keys[0];
+    } else {
+        child->keys[child->count] = parent->keys[i];
+        child->children[child->count + 1] = right->children[0];
+        parent->keys[i] = right->keys[0];
+        memmove(right->keys, right->keys + 1, (right->count - 1) * sizeof(int));
+        memmove(right->children, right->children + 1, right->count * sizeof(BTreeNode *));
+    }
+    right->count--;
+    child->count++;
+}
+
+// Folds parent->children[i + 1] into parent->children[i]
+static void mergeChildren(BTreeNode *parent, int i) {
+    BTreeNode *left = parent->children[i];
+    BTreeNode *right = parent->children[i + 1];
+
+    if (left->leaf) {
+        memcpy(left->keys + left->count, right->keys, right->count * sizeof(int));
+        memcpy(left->values + left->count, right->values, right->count * sizeof(uintptr_t));
+        left->count += right->count;
+        left->next = right->next;
+    } else {
+        left->keys[left->count] = parent->keys[i];
+        memcpy(left->keys + left->count + 1, right->keys, right->count * sizeof(int));
+        memcpy(left->children + left->count + 1, right->children, (right->count + 1) * sizeof(BTreeNode *));
+        left->count += right->count + 1;
+    }
+    free(right);
+
+    memmove(parent->keys + i, parent->keys + i + 1, (parent->count - i - 1) * sizeof(int));
+    memmove(parent->children + i + 1, parent->children + i + 2, (parent->count - i - 1) * sizeof(BTreeNode *));
+    parent->count--;
+}
+
+// Refills parent->children[i] after it dropped below the minimum
+static void rebalance(BTreeNode *parent, int i) {
+    if (i > 0 && parent->children[i - 1]->count > minKeys(parent->children[i - 1])) {
+        borrowFromLeft(parent, i);
+    } else if (i < parent->count && parent->children[i + 1]->count > minKeys(parent->children[i + 1])) {
+        borrowFromRight(parent, i);
+    } else if (i > 0) {
+        mergeChildren(parent, i - 1);
+    } else {
+        mergeChildren(parent, i);
+    }
+}
+
+static bool removeFrom(BTreeNode *node, int key) {
+    if (node->leaf) {
+        int position = lowerBound(node, key);
+        if (position == node->count || node->keys[position] != key) {
+            return false;
+        }
+        memmove(node->keys + position, node->keys + position + 1, (node->count - position - 1) * sizeof(int));
+        memmove(node->values + position, node->values + position + 1,
+                (node->count - position - 1) * sizeof(uintptr_t));
+        node->count--;
+        return true;
+    }
+
+    int i = childIndex(node, key);
+    if (!removeFrom(node->children[i], key)) {
+        return false;
+    }
+    if (node->children[i]->count < minKeys(node->children[i])) {
+        rebalance(node, i);
+    }
+    return true;
+}
+
+bool btreeIndexRemove(BTreeIndex *index, int key) {
+    if (!removeFrom(index->root, key)) {
+        return false;
+    }
+    index->count--;
+
+    // An inner root left with a single child hands the root over to it
+    if (!index->root->leaf && index->root->count == 0) {
+        BTreeNode *root = index->root;
+        index->root = root->children[0];
+        index->height--;
+        free(root);
+    }
+    return true;
+}
+
+void btreeIndexSeek(const BTreeIndex *index, int first, int last, BTreeCursor *cursor) {
+    cursor->leaf = findLeaf(index, first);
+    cursor->position = lowerBound(cursor->leaf, first);
+    cursor->last = last;
+}
+
+bool btreeIndexNext(BTreeCursor *cursor) {
+    while (cursor->leaf != NULL && cursor->position == cursor->leaf->count) {
+        cursor->leaf = cursor->leaf->next;
+        cursor->position = 0;
+    }
+    if (cursor->leaf == NULL || cursor->leaf->keys[cursor->position] > cursor->last) {
+        cursor->leaf = NULL;
+        return false;
+    }
+    cursor->key = cursor->leaf->keys[cursor->position];
+    cursor->value = cursor->leaf->values[cursor->position];
+    cursor->position++;
+    return true;
+}
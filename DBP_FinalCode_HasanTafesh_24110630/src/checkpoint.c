@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "../include/checkpoint.h"
+#include "../include/storage.h"
+#include "../include/wal.h"
+
+static pthread_t checkpointThread;
+static bool checkpointRunning = false;
+static pthread_mutex_t checkpointMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t checkpointCond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t checkpointRunMutex = PTHREAD_MUTEX_INITIALIZER;  // One checkpoint at a time
+
+// Statistics
+static uint64_t checkpointCount = 0;
+static uint64_t lastCheckpointLsn = 0;
+static double lastCheckpointSeconds = 0;
+
+static double elapsedSeconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Write every table image and drop the log segments they cover. Writers are
+// only blocked while their own table is copied out, see storageCheckpoint.
+bool checkpointRun() {
+    pthread_mutex_lock(&checkpointRunMutex);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    uint64_t lsn;
+    uint32_t segment;
+    bool ok = walBeginCheckpoint(&lsn, &segment);
+    if (ok) {
+        ok = storageCheckpointAll(lsn, segment);
+    }
+
+    // Keep the old segments if any table failed, recovery still needs them
+    if (ok) {
+        walRemoveSegments(segment);
+        checkpointCount++;
+        lastCheckpointLsn = lsn;
+        lastCheckpointSeconds = elapsedSeconds(&start);
+    } else {
+        printf("Error: Checkpoint failed, the log was not truncated.\n");
+    }
+
+    pthread_mutex_unlock(&checkpointRunMutex);
+    return ok;
+}
+
+static void *checkpointWorker(void *arg) {
+    (void)arg;
+    struct timespec lastRun;
+    clock_gettime(CLOCK_MONOTONIC, &lastRun);
+
+    pthread_mutex_lock(&checkpointMutex);
+    while (checkpointRunning) {
+        // Wake up once a second to look at the log size
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += 1;
+        pthread_cond_timedwait(&checkpointCond, &checkpointMutex, &deadline);
+        if (!checkpointRunning) break;
+
+        uint64_t pending = walPendingBytes();
+        if (pending > 0 && (pending >= CHECKPOINT_LOG_BYTES ||
+                            elapsedSeconds(&lastRun) >= CHECKPOINT_INTERVAL_SECONDS)) {
+            pthread_mutex_unlock(&checkpointMutex);
+            checkpointRun();
+            clock_gettime(CLOCK_MONOTONIC, &lastRun);
+            pthread_mutex_lock(&checkpointMutex);
+        }
+    }
+    pthread_mutex_unlock(&checkpointMutex);
+    return NULL;
+}
+
+void checkpointStart() {
+    checkpointRunning = true;
+    if (pthread_create(&checkpointThread, NULL, checkpointWorker, NULL) != 0) {
+        printf("Error: Could not start the checkpoint thread.\n");
+        checkpointRunning = false;
+    }
+}
+
+// Stop the background thread and take a final checkpoint so the next start
+// does not have to replay anything
+void checkpointStop() {
+    pthread_mutex_lock(&checkpointMutex);
+    bool wasRunning = checkpointRunning;
+    checkpointRunning = false;
+    pthread_cond_signal(&checkpointCond);
+    pthread_mutex_unlock(&checkpointMutex);
+
+    if (wasRunning) {
+        pthread_join(checkpointThread, NULL);
+    }
+    // Also write the snapshot images a table started without
+    if (walPendingBytes() > 0 || storageImagesOutdated()) {
+        checkpointRun();
+    }
+}
+
+void showCheckpointStatistics() {
+    pthread_mutex_lock(&checkpointRunMutex);
+    printf("\nCheckpoints: %llu\n", (unsigned long long)checkpointCount);
+    printf("Last checkpoint LSN: %llu\n", (unsigned long long)lastCheckpointLsn);
+    printf("Last checkpoint duration: %.3f s\n", lastCheckpointSeconds);
+    pthread_mutex_unlock(&checkpointRunMutex);
+}
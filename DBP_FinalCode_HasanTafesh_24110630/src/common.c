@@ -3,12 +3,6 @@
 #include "../include/department.h"
 #include "../include/instructor.h"
 
-int hashTableSize = HASH_TABLE_SIZE;
-
-int hash(int key) {
-    return key % HASH_TABLE_SIZE;
-}
-
 bool validateDepartmentReference(int departmentId) {
     Department *dept = searchDepartmentById(departmentId);
     if (!dept) {
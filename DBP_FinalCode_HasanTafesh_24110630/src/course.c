@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <limits.h>
 #include <ctype.h>
 #include "../include/course.h"
 #include "../include/department.h"
@@ -10,62 +11,249 @@
 #include "../include/enrollment.h"
 #include "../include/common.h"
 #include "../include/lock_management.h"
+#include "../include/storage.h"
+#include "../include/wal.h"
+#include "../include/hash_index.h"
+#include "../include/text_reader.h"
+#include "../include/row_printer.h"
+
+void removeCourse(Course *course);
+
+// Storage engine callbacks
+void loadCourseRecord(const void *record, void *ctx);
+void *adoptCourseRecord(const void *record);
+uint64_t courseImageKey(int index, const void *record);
+bool parseCourseText(const char *line, size_t length, void *record);
+void formatCourseText(FILE *file, const void *record);
+void forEachCourse(void (*visit)(const void *record, void *ctx), void *ctx);
+void redoCourseLog(int operation, const void *image);
 
 // Global variables
-Course **courseHashTable = NULL; // Dynamic hash table pointer
-CourseTitleIdMapping courseTitleMapping[NAME_MAPPING_SIZE];
-int courseMappingCount = 0;
+HashIndex courseIndex; // Maps ID to course record
+RefIndex coursesByDepartment; // Maps department ID to its courses
+RefIndex coursesByInstructor; // Maps instructor ID to the courses they teach
+HashIndex courseTitleIndex; // Maps title to course records
+PrefixIndex courseTitlePrefixIndex; // Titles in order, for prefix searches
 int courseCounter = 0;
-int *courseIdArray;
+BTreeIndex courseIdTree; // Maps ID to course record in ID order
+
+StorageTable courseStorage = {
+    .tableId = COURSE_TABLE_ID,
+    .name = "Courses",
+    .dataPath = "data/Courses.db",
+    .textPath = "data/Courses.txt",
+    .recordSize = sizeof(Course),
+    .index = &courseIndex,
+    .parseText = parseCourseText,
+    .formatText = formatCourseText,
+    .forEachRecord = forEachCourse,
+    .redoLog = redoCourseLog,
+    .imagePath = "data/Courses.idx",
+    .imageIndexes = { &courseIndex, &courseTitleIndex },
+    .imageIndexCount = 2,
+    .imageRefIndexes = { &coursesByDepartment, &coursesByInstructor },
+    .imageRefIndexCount = 2,
+    .imageKey = courseImageKey,
+};
+
+static bool courseTitleMatches(uintptr_t value, const void *title) {
+    return strcmp(((Course *)value)->title, (const char *)title) == 0;
+}
+
+// Add a course to every index, undoing the ones done so far on failure
+static bool indexCourse(Course *course) {
+    uintptr_t handle = (uintptr_t)course;
 
-// Comparison functions for sorting
-int compareCourseTitle(const void *a, const void *b) {
-    return strcmp(((CourseTitleIdMapping *)a)->title, ((CourseTitleIdMapping *)b)->title);
+    if (!hashIndexInsert(&courseIndex, (uint64_t)course->id, handle)) {
+        return false;
+    }
+    if (!refIndexAdd(&coursesByDepartment, (uint64_t)course->departmentId, handle)) {
+        hashIndexRemove(&courseIndex, (uint64_t)course->id, handle);
+        return false;
+    }
+    if (!refIndexAdd(&coursesByInstructor, (uint64_t)course->instructorId, handle)) {
+        refIndexRemove(&coursesByDepartment, (uint64_t)course->departmentId, handle);
+        hashIndexRemove(&courseIndex, (uint64_t)course->id, handle);
+        return false;
+    }
+    if (!hashIndexInsert(&courseTitleIndex, hashIndexStringKey(course->title), handle)) {
+        refIndexRemove(&coursesByInstructor, (uint64_t)course->instructorId, handle);
+        refIndexRemove(&coursesByDepartment, (uint64_t)course->departmentId, handle);
+        hashIndexRemove(&courseIndex, (uint64_t)course->id, handle);
+        return false;
+    }
+    if (!prefixIndexInsert(&courseTitlePrefixIndex, course->title, handle)) {
+        hashIndexRemove(&courseTitleIndex, hashIndexStringKey(course->title), handle);
+        refIndexRemove(&coursesByInstructor, (uint64_t)course->instructorId, handle);
+        refIndexRemove(&coursesByDepartment, (uint64_t)course->departmentId, handle);
+        hashIndexRemove(&courseIndex, (uint64_t)course->id, handle);
+        return false;
+    }
+    return true;
 }
 
-int compareCourseId(const void *a, const void *b) {
-    return (*(int *)a - *(int *)b);
+static void unindexCourse(Course *course) {
+    uintptr_t handle = (uintptr_t)course;
+    hashIndexRemove(&courseIndex, (uint64_t)course->id, handle);
+    refIndexRemove(&coursesByDepartment, (uint64_t)course->departmentId, handle);
+    refIndexRemove(&coursesByInstructor, (uint64_t)course->instructorId, handle);
+    hashIndexRemove(&courseTitleIndex, hashIndexStringKey(course->title), handle);
+    prefixIndexRemove(&courseTitlePrefixIndex, course->title, handle);
 }
 
 // Initialize courses
 void initCourses() {
-    // Allocate dynamic hash table
-    courseHashTable = calloc(hashTableSize, sizeof(Course *));
-    if (courseHashTable == NULL) {
-        printf("Memory allocation failed for course hash table.\n");
+    // Allocate the hash index
+    if (!hashIndexInit(&courseIndex, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for course hash index.\n");
         exit(EXIT_FAILURE);
     }
-
-    // Allocate ID array
-    courseIdArray = malloc(hashTableSize * sizeof(int));
-    if (courseIdArray == NULL) {
-        printf("Memory allocation failed for course ID array.\n");
+    if (!refIndexInit(&coursesByDepartment, HASH_TABLE_SIZE) ||
+        !refIndexInit(&coursesByInstructor, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for course reference indexes.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!hashIndexInit(&courseTitleIndex, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for course title index.\n");
         exit(EXIT_FAILURE);
     }
+    prefixIndexInit(&courseTitlePrefixIndex);
 
-    for (int i = 0; i < hashTableSize; i++) {
-        courseIdArray[i] = -1;
+    if (!btreeIndexInit(&courseIdTree)) {
+        printf("Memory allocation failed for course ID tree.\n");
+        exit(EXIT_FAILURE);
     }
 
-    // Read courses from file
-    FILE *file = fopen("data/Courses.txt", "r");
-    if (file != NULL) {
-        int id, credits, departmentId, instructorId;
-        char title[100];
+    // Load the page file in bulk. The snapshot image of the last checkpoint
+    // brings the hash and reference indexes prebuilt; without one the hash
+    // indexes are sized for every stored row up front. The ID tree is built
+    // once, after the scan.
+    if (storageOpen(&courseStorage)) {
+        btreeIndexBeginBulk(&courseIdTree);
+        if (!storageLoadImage(&courseStorage, adoptCourseRecord)) {
+            size_t rows = courseStorage.header.recordCount;
+            if (!hashIndexReserve(&courseIndex, rows) || !hashIndexReserve(&courseTitleIndex, rows)) {
+                printf("Memory allocation failed for course indexes.\n");
+                exit(EXIT_FAILURE);
+            }
+            storageScan(&courseStorage, loadCourseRecord, NULL);
+        }
+        if (!btreeIndexEndBulk(&courseIdTree)) {
+            printf("Failed to build the course ID tree.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
 
-        while (fscanf(file, "%d %s %d %d %d\n", &id, title, &credits,
-                     &departmentId, &instructorId) != EOF) {
-            Course *course = malloc(sizeof(Course));
-            course->id = id;
-            strncpy(course->title, title, 100);
-            course->credits = credits;
-            course->departmentId = departmentId;
-            course->instructorId = instructorId;
-            course->occupied = 1;
-
-            insertCourse(course, true);
+// Count the courses whose department or instructor does not exist, once
+// after loading
+void checkCourseReferences() {
+    int dangling = 0;
+
+    acquire_lock(2, SHARED);
+    BTreeCursor cursor;
+    btreeIndexSeek(&courseIdTree, INT_MIN, INT_MAX, &cursor);
+    while (btreeIndexNext(&cursor)) {
+        Course *course = (Course *)cursor.value;
+        if (searchDepartmentById(course->departmentId) == NULL ||
+            searchInstructorById(course->instructorId) == NULL) {
+            dangling++;
         }
-        fclose(file);
+    }
+    release_lock(2, SHARED);
+
+    if (dangling > 0) {
+        printf("Warning: %d course(s) refer to a missing department or instructor.\n", dangling);
+    }
+}
+
+void loadCourseRecord(const void *record, void *ctx) {
+    (void)ctx;
+    Course *course = malloc(sizeof(Course));
+    if (course == NULL) {
+        printf("Memory allocation failed for course entry.\n");
+        return;
+    }
+    memcpy(course, record, sizeof(Course));
+    course->occupied = 1;
+    insertCourse(course, true);
+}
+
+// Loads a course when starting from the snapshot image. The title prefix
+// index and the ID tree are filled here, the other indexes come prebuilt.
+void *adoptCourseRecord(const void *record) {
+    Course *course = malloc(sizeof(Course));
+    if (course == NULL) {
+        printf("Memory allocation failed for course entry.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(course, record, sizeof(Course));
+    course->occupied = 1;
+
+    uintptr_t handle = (uintptr_t)course;
+    if (!prefixIndexInsert(&courseTitlePrefixIndex, course->title, handle) ||
+        !btreeIndexInsert(&courseIdTree, course->id, handle)) {
+        printf("Memory allocation failed for course indexes.\n");
+        exit(EXIT_FAILURE);
+    }
+    courseCounter++;
+    return course;
+}
+
+// Keys of the image indexes: courseStorage.imageIndexes, then imageRefIndexes
+uint64_t courseImageKey(int index, const void *record) {
+    const Course *course = (const Course *)record;
+    switch (index) {
+        case 0: return (uint64_t)course->id;
+        case 1: return hashIndexStringKey(course->title);
+        case 2: return (uint64_t)course->departmentId;
+        default: return (uint64_t)course->instructorId;
+    }
+}
+
+bool parseCourseText(const char *line, size_t length, void *record) {
+    Course *course = (Course *)record;
+    TextFields fields;
+    textFieldsInit(&fields, line, length);
+    if (!textFieldInt(&fields, &course->id) ||
+        !textFieldString(&fields, course->title, sizeof(course->title)) ||
+        !textFieldInt(&fields, &course->credits) ||
+        !textFieldInt(&fields, &course->departmentId) ||
+        !textFieldInt(&fields, &course->instructorId)) {
+        return false;
+    }
+    course->occupied = 1;
+    return true;
+}
+
+void formatCourseText(FILE *file, const void *record) {
+    const Course *course = (const Course *)record;
+    fprintf(file, "%d %s %d %d %d\n",
+            course->id, course->title, course->credits,
+            course->departmentId, course->instructorId);
+}
+
+void forEachCourse(void (*visit)(const void *record, void *ctx), void *ctx) {
+    acquire_lock(2, SHARED);
+    BTreeCursor cursor;
+    btreeIndexSeek(&courseIdTree, INT_MIN, INT_MAX, &cursor);
+    while (btreeIndexNext(&cursor)) {
+        visit((const void *)cursor.value, ctx);
+    }
+    release_lock(2, SHARED);
+}
+
+// Replace or remove the course with the logged key
+void redoCourseLog(int operation, const void *image) {
+    int id;
+    memcpy(&id, image, sizeof(int));
+
+    Course *existing = searchCourseById(id);
+    if (existing != NULL) {
+        removeCourse(existing);
+    }
+    if (operation != WAL_DELETE) {
+        loadCourseRecord(image, NULL);
     }
 }
 
@@ -76,11 +264,27 @@ bool validateCourseData(Course *course) {
         printf("Error: Credits must be positive.\n");
         return false;
     }
-    if (searchDepartmentById(course->departmentId) == NULL) {
+
+    // The caller holds the course table, so these waits may be aborted to
+    // break a deadlock with deleteDepartment or deleteInstructor
+    if (!acquire_lock_abortable(3, SHARED)) {
+        printf("Error: Departments are locked by another user, try again.\n");
+        return false;
+    }
+    bool departmentFound = searchDepartmentById(course->departmentId) != NULL;
+    release_lock(3, SHARED);
+    if (!departmentFound) {
         printf("Error: Department ID %d does not exist.\n", course->departmentId);
         return false;
     }
-    if (searchInstructorById(course->instructorId) == NULL) {
+
+    if (!acquire_lock_abortable(5, SHARED)) {
+        printf("Error: Instructors are locked by another user, try again.\n");
+        return false;
+    }
+    bool instructorFound = searchInstructorById(course->instructorId) != NULL;
+    release_lock(5, SHARED);
+    if (!instructorFound) {
         printf("Error: Instructor ID %d does not exist.\n", course->instructorId);
         return false;
     }
@@ -98,91 +302,36 @@ void insertCourse(Course *course, bool isInit) {
     }
 
     // Check for duplicate ID
-    if (bsearch(&(course->id), courseIdArray, courseCounter, sizeof(int), compareCourseId) != NULL) {
+    if (searchCourseById(course->id) != NULL) {
         printf("\nFailed to add course. A course with ID %d already exists.\n", course->id);
         release_lock(2, EXCLUSIVE);
         return;
     }
 
-    // Resize the hash table if load factor exceeds 0.75
-    if ((float)courseCounter / hashTableSize > 0.75) { // Load factor > 0.75
-        int newSize = hashTableSize * 2; // Double the size
-        Course **newHashTable = calloc(newSize, sizeof(Course *));
-        if (newHashTable == NULL) {
-            printf("Error: Memory allocation failed during hash table resizing.\n");
-            release_lock(2, EXCLUSIVE);
-            return;
-        }
-
-        // Rehash existing courses into the new table
-        for (int i = 0; i < hashTableSize; i++) {
-            if (courseHashTable[i] != NULL && courseHashTable[i]->occupied) {
-                int newIndex = hash(courseHashTable[i]->id) % newSize;
-                while (newHashTable[newIndex] != NULL) {
-                    newIndex = (newIndex + 1) % newSize;
-                }
-                newHashTable[newIndex] = courseHashTable[i];
-            }
-        }
-
-        free(courseHashTable);
-        courseHashTable = newHashTable;
-        hashTableSize = newSize;
-    }
-
-    // Resize the ID array if necessary
-    if (courseCounter == hashTableSize) {
-        int *newIdArray = realloc(courseIdArray, hashTableSize * 2 * sizeof(int));
-        if (newIdArray == NULL) {
-            printf("Error: Memory allocation failed for course ID array resizing.\n");
-            release_lock(2, EXCLUSIVE);
-            return;
-        }
-        courseIdArray = newIdArray;
-    }
-
-    // Add ID to array and sort
-    courseIdArray[courseCounter++] = course->id;
-    qsort(courseIdArray, courseCounter, sizeof(int), compareCourseId);
-
-    // Insert course into hash table
-    int index = hash(course->id) % hashTableSize;
-    int originalIndex = index;
-    while (courseHashTable[index] != NULL) {
-        if (!courseHashTable[index]->occupied) { 
-            free(courseHashTable[index]);
-            break;
-        }
-        index = (index + 1) % hashTableSize; 
-        if (index == originalIndex) { 
-            printf("Error: Hash table is full. Cannot insert course.\n");
-            release_lock(2, EXCLUSIVE);
-            return;
-        }
+    // Insert into the hash and reference indexes
+    if (!indexCourse(course)) {
+        release_lock(2, EXCLUSIVE);
+        return;
     }
-    courseHashTable[index] = course;
-    courseHashTable[index]->occupied = 1;
+    course->occupied = 1;
 
-    // Add to title mapping array
-    if (courseMappingCount < NAME_MAPPING_SIZE) {
-        strncpy(courseTitleMapping[courseMappingCount].title, course->title, 50);
-        courseTitleMapping[courseMappingCount].id = course->id;
-        courseMappingCount++;
-        qsort(courseTitleMapping, courseMappingCount, sizeof(CourseTitleIdMapping), compareCourseTitle);
+    // Add to the ordered ID index
+    if (!btreeIndexInsert(&courseIdTree, course->id, (uintptr_t)course)) {
+        unindexCourse(course);
+        course->occupied = 0;
+        release_lock(2, EXCLUSIVE);
+        return;
     }
+    courseCounter++;
 
-    // Store course in file if not during initialization
+    // Log the new course if not during initialization, a course that
+    // cannot be logged would be lost on restart
     if (!isInit) {
-        FILE *file = fopen("data/Courses.txt", "a");
-        if (file) {
-            fprintf(file, "%d %s %d %d %d\n", 
-                    course->id, course->title, course->credits,
-                    course->departmentId, course->instructorId);
-            fflush(file);
-            fclose(file);
-            printf("\nCourse added successfully!\n");
+        if (walLog(&courseStorage, WAL_INSERT, NULL, course) == 0) {
+            printf("\nFailed to add course. The change could not be logged.\n");
+            removeCourse(course);
         } else {
-            perror("Failed to write to Courses.txt");
+            printf("\nCourse added successfully!\n");
         }
     }
 
@@ -204,32 +353,24 @@ void updateCourse(int id, int instructorId) {
             return;
         }
 
+        // Move the course to the new instructor's list
+        if (!refIndexAdd(&coursesByInstructor, (uint64_t)instructorId, (uintptr_t)course)) {
+            release_lock(2, EXCLUSIVE);
+            return;
+        }
+        refIndexRemove(&coursesByInstructor, (uint64_t)course->instructorId, (uintptr_t)course);
+
+        Course before = *course;
         course->instructorId = instructorId;
-        printf("\nInstructor updated successfully.\n");
-
-        // Update file
-        FILE *file = fopen("data/Courses.txt", "r");
-        FILE *temp = fopen("data/Courses_temp.txt", "w");
-
-        if (file != NULL && temp != NULL) {
-            int curr_id, credits, departmentId, curr_instructorId;
-            char title[100];
-
-            while (fscanf(file, "%d %s %d %d %d\n", &curr_id, title, &credits,
-                          &departmentId, &curr_instructorId) != EOF) {
-                if (curr_id == id) {
-                    fprintf(temp, "%d %s %d %d %d\n", id, title, credits,
-                            departmentId, instructorId);
-                } else {
-                    fprintf(temp, "%d %s %d %d %d\n", curr_id, title, credits,
-                            departmentId, curr_instructorId);
-                }
-            }
 
-            fclose(file);
-            fclose(temp);
-            remove("data/Courses.txt");
-            rename("data/Courses_temp.txt", "data/Courses.txt");
+        // Log the change instead of rewriting the page file
+        if (walLog(&courseStorage, WAL_UPDATE, &before, course) == 0) {
+            refIndexAdd(&coursesByInstructor, (uint64_t)before.instructorId, (uintptr_t)course);
+            refIndexRemove(&coursesByInstructor, (uint64_t)instructorId, (uintptr_t)course);
+            *course = before;
+            printf("Error: The change could not be logged, the instructor was not updated.\n");
+        } else {
+            printf("\nInstructor updated successfully.\n");
         }
     } else {
         printf("Course not found.\n");
@@ -242,90 +383,64 @@ void updateCourse(int id, int instructorId) {
 void deleteCourse(int id) {
     acquire_lock(2, EXCLUSIVE); // Lock for deleting a course
 
-    int index = hash(id);
-    while (courseHashTable[index] != NULL) {
-        if (courseHashTable[index]->occupied && courseHashTable[index]->id == id) {
-            // Check for existing enrollments
-            for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-                if (enrollmentHashTable[i] != NULL && enrollmentHashTable[i]->occupied &&
-                    enrollmentHashTable[i]->courseId == id) {
-                    printf("Error: Cannot delete course - Students are enrolled\n");
-                    release_lock(2, EXCLUSIVE); // Unlock if there are enrollments
-                    return;
-                }
-            }
-
-            courseHashTable[index]->occupied = 0;
-            printf("\nCourse %s deleted successfully!\n", courseHashTable[index]->title);
-
-            // Remove from mapping array
-            for (int i = 0; i < courseMappingCount; i++) {
-                if (courseTitleMapping[i].id == id) {
-                    for (int j = i; j < courseMappingCount - 1; j++) {
-                        courseTitleMapping[j] = courseTitleMapping[j + 1];
-                    }
-                    courseMappingCount--;
-                    break;
-                }
-            }
-
-            // Remove from ID array
-            int *found = bsearch(&id, courseIdArray, courseCounter, sizeof(int), compareCourseId);
-            if (found != NULL) {
-                memmove(found, found + 1, (--courseCounter - (found - courseIdArray)) * sizeof(int));
-            }
+    Course *course = searchCourseById(id);
+    if (course == NULL) {
+        printf("Course not found.\n");
+        release_lock(2, EXCLUSIVE);
+        return;
+    }
 
-            // Update file
-            FILE *file = fopen("data/Courses.txt", "r");
-            FILE *temp = fopen("data/Courses_temp.txt", "w");
+    // Check for existing enrollments. New ones wait for the course lock, so
+    // the enrollment lock is only needed while counting.
+    if (!acquire_lock_abortable(4, SHARED)) {
+        printf("Error: Enrollments are locked by another user, try again.\n");
+        release_lock(2, EXCLUSIVE);
+        return;
+    }
+    size_t enrolled = refIndexCount(&enrollmentsByCourse, (uint64_t)id);
+    release_lock(4, SHARED);
+    if (enrolled > 0) {
+        printf("Error: Cannot delete course - Students are enrolled\n");
+        release_lock(2, EXCLUSIVE); // Unlock if there are enrollments
+        return;
+    }
 
-            if (file != NULL && temp != NULL) {
-                int curr_id, credits, departmentId, instructorId;
-                char title[100];
+    if (walLog(&courseStorage, WAL_DELETE, course, NULL) == 0) {
+        printf("Error: The change could not be logged, the course was not deleted.\n");
+    } else {
+        printf("\nCourse %s deleted successfully!\n", course->title);
+        removeCourse(course);
+    }
 
-                while (fscanf(file, "%d %s %d %d %d\n", &curr_id, title, &credits,
-                              &departmentId, &instructorId) != EOF) {
-                    if (curr_id != id) {
-                        fprintf(temp, "%d %s %d %d %d\n", curr_id, title, credits,
-                                departmentId, instructorId);
-                    }
-                }
+    release_lock(2, EXCLUSIVE); // Unlock after deletion
+}
 
-                fclose(file);
-                fclose(temp);
-                remove("data/Courses.txt");
-                rename("data/Courses_temp.txt", "data/Courses.txt");
-            }
+// Remove a course from the indexes and free it.
+void removeCourse(Course *course) {
+    int id = course->id;
+    unindexCourse(course);
 
-            release_lock(2, EXCLUSIVE); // Unlock after deletion
-            return;
-        }
-        index = hash(index + 1);
+    if (btreeIndexRemove(&courseIdTree, id)) {
+        courseCounter--;
     }
-    printf("Course not found.\n");
-    release_lock(2, EXCLUSIVE);
+
+    free(course);
 }
 
 // Search functions
 Course *searchCourseById(int id) {
-    int index = hash(id);
-    while (courseHashTable[index] != NULL) {
-        if (courseHashTable[index]->occupied && courseHashTable[index]->id == id) {
-            Course *result = courseHashTable[index];
-            return result;
-        }
-        index = hash(index + 1);
+    uintptr_t value;
+    if (hashIndexFind(&courseIndex, (uint64_t)id, &value)) {
+        return (Course *)value;
     }
     return NULL;
 }
 
 
 Course *searchCourseByTitle(char title[]) {
-    for (int i = 0; i < courseMappingCount; i++) {
-        if (strcmp(courseTitleMapping[i].title, title) == 0) {
-            Course *result = searchCourseById(courseTitleMapping[i].id);
-            return result;
-        }
+    uintptr_t value;
+    if (hashIndexFindMatch(&courseTitleIndex, hashIndexStringKey(title), courseTitleMatches, title, &value)) {
+        return (Course *)value;
     }
     return NULL;
 }
@@ -335,12 +450,10 @@ void searchCoursesByDepartment(int departmentId) {
     printf("\nCourses in Department %d:\n", departmentId);
     bool found = false;
 
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (courseHashTable[i] != NULL && courseHashTable[i]->occupied && 
-            courseHashTable[i]->departmentId == departmentId) {
-            showCourse(courseHashTable[i]);
-            found = true;
-        }
+    const RefList *list = refIndexFind(&coursesByDepartment, (uint64_t)departmentId);
+    for (size_t i = 0; list != NULL && i < list->count; i++) {
+        showCourse((Course *)list->handles[i]);
+        found = true;
     }
 
     if (!found) {
@@ -348,36 +461,29 @@ void searchCoursesByDepartment(int departmentId) {
     }
 }
 
-// Display functions
-void *printCourse(void *arg) {
-    CourseThreadArg *threadArg = (CourseThreadArg *)arg;
-    Course *course = threadArg->course;
+// Courses whose title starts with prefix, ignoring case, in title order
+int searchCoursesByTitlePrefix(char prefix[], Course *results[], int limit) {
+    if (limit <= 0) return 0;
 
-    printf("Course ID: %d Title: %s Credits: %d Department ID: %d Instructor ID: %d\n",
-           course->id, course->title, course->credits, course->departmentId, course->instructorId);
+    uintptr_t handles[limit];
+    size_t found = prefixIndexSearch(&courseTitlePrefixIndex, prefix, handles, (size_t)limit);
+    for (size_t i = 0; i < found; i++) {
+        results[i] = (Course *)handles[i];
+    }
+    return (int)found;
+}
 
-    return NULL;
+// Display functions
+static int formatCourseRow(char *buffer, size_t size, const void *row) {
+    const Course *course = (const Course *)row;
+    return snprintf(buffer, size, "Course ID: %d Title: %s Credits: %d Department ID: %d Instructor ID: %d\n",
+                    course->id, course->title, course->credits, course->departmentId, course->instructorId);
 }
 
 void showAllCourses() {
     acquire_lock(2, SHARED); // Acquire a shared lock before displaying
     printf("\nThere are currently %d course(s) in the database.\n", courseCounter);
-
-    pthread_t threads[courseCounter];
-    CourseThreadArg args[courseCounter];
-    int threadIndex = 0;
-
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (courseHashTable[i] != NULL && courseHashTable[i]->occupied) {
-            args[threadIndex].course = courseHashTable[i];
-            pthread_create(&threads[threadIndex], NULL, printCourse, &args[threadIndex]);
-            threadIndex++;
-        }
-    }
-
-    for (int i = 0; i < threadIndex; i++) {
-        pthread_join(threads[i], NULL);
-    }
+    printRows(&courseIdTree, formatCourseRow);
     release_lock(2, SHARED); // Release the lock after displaying
 }
 
@@ -502,6 +608,7 @@ void courseMenu() {
         printf("5. Delete Course\n");
         printf("6. Show Course Details\n");
         printf("7. Show Enrolled Students\n");
+        printf("8. Find Courses by Title Prefix\n");
         printf("0. Back to Main Menu\n");
         printf("Enter choice: ");
         
@@ -536,6 +643,15 @@ void courseMenu() {
                     if (course) showEnrolledStudents(course->id);
                 }
                 break;
+            case 8:
+                {
+                    char prefix[100];
+                    printf("Enter the start of the title: ");
+                    fgets(prefix, sizeof(prefix), stdin);
+                    prefix[strcspn(prefix, "\n")] = 0;
+                    showCourseTitleSuggestions(prefix);
+                }
+                break;
             case 0:
                 break;
             default:
@@ -546,56 +662,106 @@ void courseMenu() {
 
 // Additional functions
 void showEnrolledStudents(int courseId) {
+    // Students are looked up by ID below, so they are locked first, in the
+    // order insertEnrollment uses
+    acquire_lock(1, SHARED);
+    if (!acquire_lock_abortable(2, SHARED)) {
+        release_lock(1, SHARED);
+        printf("Error: Courses are locked by another user, try again.\n");
+        return;
+    }
     Course *course = searchCourseById(courseId);
     if (course == NULL) {
         printf("Error: Course not found\n");
+        release_lock(2, SHARED);
+        release_lock(1, SHARED);
+        return;
+    }
+
+    // Same order as showCourseStats, the enrollment lists change under row
+    // writers holding the table INTENTION_EXCLUSIVE
+    if (!acquire_lock_abortable(4, SHARED)) {
+        release_lock(2, SHARED);
+        release_lock(1, SHARED);
+        printf("Error: Enrollments are locked by another user, try again.\n");
         return;
     }
     
     printf("\nEnrolled students for course %d - %s:\n", courseId, course->title);
     bool found = false;
     
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (enrollmentHashTable[i] != NULL && enrollmentHashTable[i]->occupied &&
-            enrollmentHashTable[i]->courseId == courseId) {
-            Student *student = searchStudentById(enrollmentHashTable[i]->studentId);
-            if (student != NULL) {
-                printf("Student ID: %d\n", student->id);
-                printf("Name: %s %s\n", student->firstName, student->lastName);
-                printf("Status: %s\n", getStatusString(enrollmentHashTable[i]->status));
-                printf("Grade: %s\n", enrollmentHashTable[i]->grade);
-                printf("-------------------------\n");
-                found = true;
-            }
+    const RefList *list = refIndexFind(&enrollmentsByCourse, (uint64_t)courseId);
+    for (size_t i = 0; list != NULL && i < list->count; i++) {
+        Enrollment *entry = (Enrollment *)list->handles[i];
+        Student *student = searchStudentById(entry->studentId);
+        if (student != NULL) {
+            printf("Student ID: %d\n", student->id);
+            printf("Name: %s %s\n", student->firstName, student->lastName);
+            printf("Status: %s\n", getStatusString(entry->status));
+            printf("Grade: %s\n", entry->grade);
+            printf("-------------------------\n");
+            found = true;
         }
     }
     if (!found) {
         printf("No students enrolled in this course.\n");
     }
 
+    release_lock(4, SHARED);
+    release_lock(2, SHARED);
+    release_lock(1, SHARED);
 }
 
 void showCourseDetails(int courseId) {
+    acquire_lock(2, SHARED);
     Course *course = searchCourseById(courseId);
     if (course == NULL) {
         printf("Error: Course not found\n");
+        release_lock(2, SHARED);
         return;
     }
     
     printf("\nDetailed Course Information:\n");
     showCourse(course);
     
-    Department *dept = searchDepartmentById(course->departmentId);
-    if (dept) {
-        printf("Department: %s\n", dept->name);
+    // The names come from other tables, each read under its own lock
+    if (acquire_lock_abortable(3, SHARED)) {
+        Department *dept = searchDepartmentById(course->departmentId);
+        if (dept) {
+            printf("Department: %s\n", dept->name);
+        }
+        release_lock(3, SHARED);
+    } else {
+        printf("Error: Departments are locked by another user.\n");
     }
     
-    Instructor *inst = searchInstructorById(course->instructorId);
-    if (inst) {
-        printf("Instructor: %s %s\n", inst->firstName, inst->lastName);
+    if (acquire_lock_abortable(5, SHARED)) {
+        Instructor *inst = searchInstructorById(course->instructorId);
+        if (inst) {
+            printf("Instructor: %s %s\n", inst->firstName, inst->lastName);
+        }
+        release_lock(5, SHARED);
+    } else {
+        printf("Error: Instructors are locked by another user.\n");
     }
+    release_lock(2, SHARED); // showEnrolledStudents takes its own locks
     
     printf("\nEnrolled Students:\n");
     showEnrolledStudents(courseId);
 
 }
+
+void showCourseTitleSuggestions(char prefix[]) {
+    Course *results[NAME_SUGGESTION_LIMIT];
+
+    acquire_lock(2, SHARED);
+    int found = searchCoursesByTitlePrefix(prefix, results, NAME_SUGGESTION_LIMIT);
+    printf("\nCourses matching \"%s\":\n", prefix);
+    for (int i = 0; i < found; i++) {
+        printf("ID: %d Title: %s\n", results[i]->id, results[i]->title);
+    }
+    if (found == 0) {
+        printf("No courses found.\n");
+    }
+    release_lock(2, SHARED);
+}
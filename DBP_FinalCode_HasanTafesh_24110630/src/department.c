@@ -3,69 +3,218 @@
 #include <string.h>
 #include <ctype.h>
 #include <pthread.h>
+#include <limits.h>
 #include "../include/department.h"
 #include "../include/instructor.h"
 #include "../include/course.h"
 #include "../include/student.h"
 #include "../include/common.h"
 #include "../include/lock_management.h"
-#include <unistd.h>  // Required for sleep function
-
+#include "../include/storage.h"
+#include "../include/wal.h"
+#include "../include/hash_index.h"
+#include "../include/text_reader.h"
+#include "../include/row_printer.h"
+
+void removeDepartment(Department *dept);
+
+// Storage engine callbacks
+void loadDepartmentRecord(const void *record, void *ctx);
+void *adoptDepartmentRecord(const void *record);
+uint64_t departmentImageKey(int index, const void *record);
+bool parseDepartmentText(const char *line, size_t length, void *record);
+void formatDepartmentText(FILE *file, const void *record);
+void forEachDepartment(void (*visit)(const void *record, void *ctx), void *ctx);
+void redoDepartmentLog(int operation, const void *image);
 
 // Global variables
-Department **departmentHashTable = NULL; // Dynamic hash table pointer
-DepartmentNameIdMapping departmentNameMapping[NAME_MAPPING_SIZE];
-int departmentMappingCount = 0;
+HashIndex departmentIndex; // Maps ID to department record
+HashIndex departmentPhoneIndex; // Maps phone number to department record, unique
+HashIndex departmentNameIndex; // Maps name to department records
+PrefixIndex departmentNamePrefixIndex; // Names in order, for prefix searches
 int departmentCounter = 0;
-int *departmentIdArray;
+BTreeIndex departmentIdTree; // Maps ID to department record in ID order
+
+StorageTable departmentStorage = {
+    .tableId = DEPARTMENT_TABLE_ID,
+    .name = "Departments",
+    .dataPath = "data/Departments.db",
+    .textPath = "data/Departments.txt",
+    .recordSize = sizeof(Department),
+    .index = &departmentIndex,
+    .parseText = parseDepartmentText,
+    .formatText = formatDepartmentText,
+    .forEachRecord = forEachDepartment,
+    .redoLog = redoDepartmentLog,
+    .imagePath = "data/Departments.idx",
+    .imageIndexes = { &departmentIndex, &departmentPhoneIndex, &departmentNameIndex },
+    .imageIndexCount = 3,
+    .imageKey = departmentImageKey,
+};
+
+static bool departmentPhoneMatches(uintptr_t value, const void *phone) {
+    return strcmp(((Department *)value)->phone, (const char *)phone) == 0;
+}
 
-// Comparison functions for sorting
-int compareDepartmentName(const void *a, const void *b) {
-    return strcmp(((DepartmentNameIdMapping *)a)->name, ((DepartmentNameIdMapping *)b)->name);
+static bool departmentNameMatches(uintptr_t value, const void *name) {
+    return strcmp(((Department *)value)->name, (const char *)name) == 0;
 }
 
-int compareDepartmentId(const void *a, const void *b) {
-    return (*(int *)a - *(int *)b);
+// Add a department to every index, undoing the ones done so far on failure
+static bool indexDepartment(Department *dept) {
+    uintptr_t handle = (uintptr_t)dept;
+
+    if (!hashIndexInsert(&departmentIndex, (uint64_t)dept->id, handle)) {
+        return false;
+    }
+    if (!hashIndexInsert(&departmentPhoneIndex, hashIndexStringKey(dept->phone), handle)) {
+        hashIndexRemove(&departmentIndex, (uint64_t)dept->id, handle);
+        return false;
+    }
+    if (!hashIndexInsert(&departmentNameIndex, hashIndexStringKey(dept->name), handle)) {
+        hashIndexRemove(&departmentPhoneIndex, hashIndexStringKey(dept->phone), handle);
+        hashIndexRemove(&departmentIndex, (uint64_t)dept->id, handle);
+        return false;
+    }
+    if (!prefixIndexInsert(&departmentNamePrefixIndex, dept->name, handle)) {
+        hashIndexRemove(&departmentNameIndex, hashIndexStringKey(dept->name), handle);
+        hashIndexRemove(&departmentPhoneIndex, hashIndexStringKey(dept->phone), handle);
+        hashIndexRemove(&departmentIndex, (uint64_t)dept->id, handle);
+        return false;
+    }
+    return true;
+}
+
+static void unindexDepartment(Department *dept) {
+    uintptr_t handle = (uintptr_t)dept;
+    hashIndexRemove(&departmentIndex, (uint64_t)dept->id, handle);
+    hashIndexRemove(&departmentPhoneIndex, hashIndexStringKey(dept->phone), handle);
+    hashIndexRemove(&departmentNameIndex, hashIndexStringKey(dept->name), handle);
+    prefixIndexRemove(&departmentNamePrefixIndex, dept->name, handle);
 }
 
 // Initialize departments
 void initDepartments() {
-    departmentHashTable = calloc(hashTableSize, sizeof(Department *));
-    if (!departmentHashTable) {
-        printf("Memory allocation failed for department hash table.\n");
+    // Allocate the hash index
+    if (!hashIndexInit(&departmentIndex, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for department hash index.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!hashIndexInit(&departmentPhoneIndex, HASH_TABLE_SIZE) ||
+        !hashIndexInit(&departmentNameIndex, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for department phone and name indexes.\n");
         exit(EXIT_FAILURE);
     }
+    prefixIndexInit(&departmentNamePrefixIndex);
 
-    departmentIdArray = malloc(hashTableSize * sizeof(int));
-    if (!departmentIdArray) {
-        printf("Memory allocation failed for department ID array.\n");
+    if (!btreeIndexInit(&departmentIdTree)) {
+        printf("Memory allocation failed for department ID tree.\n");
         exit(EXIT_FAILURE);
     }
 
-    for (int i = 0; i < hashTableSize; i++) {
-        departmentIdArray[i] = -1;
+    // Load the page file in bulk. The snapshot image of the last checkpoint
+    // brings the hash indexes prebuilt; without one they are sized for every
+    // stored row up front. The ID tree is built once, after the scan.
+    if (storageOpen(&departmentStorage)) {
+        btreeIndexBeginBulk(&departmentIdTree);
+        if (!storageLoadImage(&departmentStorage, adoptDepartmentRecord)) {
+            size_t rows = departmentStorage.header.recordCount;
+            if (!hashIndexReserve(&departmentIndex, rows) || !hashIndexReserve(&departmentPhoneIndex, rows) ||
+                !hashIndexReserve(&departmentNameIndex, rows)) {
+                printf("Memory allocation failed for department indexes.\n");
+                exit(EXIT_FAILURE);
+            }
+            storageScan(&departmentStorage, loadDepartmentRecord, NULL);
+        }
+        if (!btreeIndexEndBulk(&departmentIdTree)) {
+            printf("Failed to build the department ID tree.\n");
+            exit(EXIT_FAILURE);
+        }
     }
+}
 
-    FILE *file = fopen("data/Departments.txt", "r");
-    if (file) {
-        int id;
-        char name[100], phone[15];
+void loadDepartmentRecord(const void *record, void *ctx) {
+    (void)ctx;
+    Department *dept = malloc(sizeof(Department));
+    if (!dept) {
+        printf("Memory allocation failed for department entry.\n");
+        return;
+    }
+    memcpy(dept, record, sizeof(Department));
+    dept->occupied = 1;
+    insertDepartment(dept, true);
+}
 
-        while (fscanf(file, "%d %s %s\n", &id, name, phone) != EOF) {
-            Department *dept = malloc(sizeof(Department));
-            if (!dept) {
-                printf("Memory allocation failed for department entry.\n");
-                fclose(file);
-                return;
-            }
-            dept->id = id;
-            strncpy(dept->name, name, 100);
-            strncpy(dept->phone, phone, 15);
-            dept->occupied = 1;
+// Loads a department when starting from the snapshot image. The ID, phone
+// and name indexes come from the image, the prefix index and ID tree do not.
+void *adoptDepartmentRecord(const void *record) {
+    Department *dept = malloc(sizeof(Department));
+    if (dept == NULL) {
+        printf("Memory allocation failed for department entry.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(dept, record, sizeof(Department));
+    dept->occupied = 1;
 
-            insertDepartment(dept, true);
-        }
-        fclose(file);
+    uintptr_t handle = (uintptr_t)dept;
+    if (!prefixIndexInsert(&departmentNamePrefixIndex, dept->name, handle) ||
+        !btreeIndexInsert(&departmentIdTree, dept->id, handle)) {
+        printf("Memory allocation failed for department indexes.\n");
+        exit(EXIT_FAILURE);
+    }
+    departmentCounter++;
+    return dept;
+}
+
+// Keys of the image indexes, in the order of departmentStorage.imageIndexes
+uint64_t departmentImageKey(int index, const void *record) {
+    const Department *dept = (const Department *)record;
+    switch (index) {
+        case 0: return (uint64_t)dept->id;
+        case 1: return hashIndexStringKey(dept->phone);
+        default: return hashIndexStringKey(dept->name);
+    }
+}
+
+bool parseDepartmentText(const char *line, size_t length, void *record) {
+    Department *dept = (Department *)record;
+    TextFields fields;
+    textFieldsInit(&fields, line, length);
+    if (!textFieldInt(&fields, &dept->id) ||
+        !textFieldString(&fields, dept->name, sizeof(dept->name)) ||
+        !textFieldString(&fields, dept->phone, sizeof(dept->phone))) {
+        return false;
+    }
+    dept->occupied = 1;
+    return true;
+}
+
+void formatDepartmentText(FILE *file, const void *record) {
+    const Department *dept = (const Department *)record;
+    fprintf(file, "%d %s %s\n", dept->id, dept->name, dept->phone);
+}
+
+void forEachDepartment(void (*visit)(const void *record, void *ctx), void *ctx) {
+    acquire_lock(3, SHARED);
+    BTreeCursor cursor;
+    btreeIndexSeek(&departmentIdTree, INT_MIN, INT_MAX, &cursor);
+    while (btreeIndexNext(&cursor)) {
+        visit((const void *)cursor.value, ctx);
+    }
+    release_lock(3, SHARED);
+}
+
+// Replace or remove the department with the logged key
+void redoDepartmentLog(int operation, const void *image) {
+    int id;
+    memcpy(&id, image, sizeof(int));
+
+    Department *existing = searchDepartmentById(id);
+    if (existing != NULL) {
+        removeDepartment(existing);
+    }
+    if (operation != WAL_DELETE) {
+        loadDepartmentRecord(image, NULL);
     }
 }
 
@@ -99,89 +248,43 @@ void insertDepartment(Department *dept, bool isInit) {
     }
 
     // Check for duplicate ID
-    if (bsearch(&(dept->id), departmentIdArray, departmentCounter, sizeof(int), compareDepartmentId) != NULL) {
+    if (searchDepartmentById(dept->id) != NULL) {
         printf("\nFailed to add department. A department with ID %d already exists.\n", dept->id);
         release_lock(3, EXCLUSIVE);
         return;
     }
 
-    // Resize hash table if load factor exceeds threshold
-    if ((float)departmentCounter / hashTableSize > 0.75) { 
-        int newSize = hashTableSize * 2; 
-        Department **newHashTable = calloc(newSize, sizeof(Department *));
-        if (!newHashTable) {
-            printf("Error: Memory allocation failed during hash table resizing.\n");
-            release_lock(3, EXCLUSIVE);
-            return;
-        }
-
-        // Rehash existing entries into the new table
-        for (int i = 0; i < hashTableSize; i++) {
-            if (departmentHashTable[i] != NULL && departmentHashTable[i]->occupied) {
-                int newIndex = departmentHashTable[i]->id % newSize;
-                while (newHashTable[newIndex] != NULL) {
-                    newIndex = (newIndex + 1) % newSize;
-                }
-                newHashTable[newIndex] = departmentHashTable[i];
-            }
-        }
-
-        free(departmentHashTable);
-        departmentHashTable = newHashTable;
-        hashTableSize = newSize;
-    }
-    
-    // Resize ID array if necessary
-    if (departmentCounter == hashTableSize) {
-        int *newIdArray = realloc(departmentIdArray, hashTableSize * 2 * sizeof(int));
-        if (!newIdArray) {
-            printf("Error: Memory allocation failed for department ID array resizing.\n");
-            release_lock(3, EXCLUSIVE);
-            return;
-        }
-        departmentIdArray = newIdArray;
+    // Check for a duplicate phone number, existing records are loaded as they are
+    if (!isInit && searchDepartmentByPhone(dept->phone) != NULL) {
+        printf("\nFailed to add department. Phone number %s is already registered.\n", dept->phone);
+        release_lock(3, EXCLUSIVE);
+        return;
     }
 
-    // Add ID to array and sort
-    departmentIdArray[departmentCounter++] = dept->id;
-    qsort(departmentIdArray, departmentCounter, sizeof(int), compareDepartmentId);
-
-    // Insert department into hash table
-    int index = hash(dept->id) % hashTableSize;
-    int originalIndex = index;
-    while (departmentHashTable[index] != NULL) {
-        if (!departmentHashTable[index]->occupied) { // Reuse unoccupied slot
-            free(departmentHashTable[index]);
-            break;
-        }
-        index = (index + 1) % hashTableSize;
-        if (index == originalIndex) { 
-            printf("Error: Hash table is full. Cannot insert department.\n");
-            release_lock(3, EXCLUSIVE);
-            return;
-        }
+    // Insert into the hash indexes
+    if (!indexDepartment(dept)) {
+        release_lock(3, EXCLUSIVE);
+        return;
     }
-    departmentHashTable[index] = dept;
-    departmentHashTable[index]->occupied = 1;
+    dept->occupied = 1;
 
-    // Add to name mapping array
-    if (departmentMappingCount < NAME_MAPPING_SIZE) {
-        strncpy(departmentNameMapping[departmentMappingCount].name, dept->name, 50);
-        departmentNameMapping[departmentMappingCount].id = dept->id;
-        departmentMappingCount++;
-        qsort(departmentNameMapping, departmentMappingCount, sizeof(DepartmentNameIdMapping), compareDepartmentName);
+    // Add to the ordered ID index
+    if (!btreeIndexInsert(&departmentIdTree, dept->id, (uintptr_t)dept)) {
+        unindexDepartment(dept);
+        dept->occupied = 0;
+        release_lock(3, EXCLUSIVE);
+        return;
     }
+    departmentCounter++;
 
-    // Store department in file if not during initialization
+    // Log the new department if not during initialization, a department
+    // that cannot be logged would be lost on restart
     if (!isInit) {
-        FILE *file = fopen("data/Departments.txt", "a");
-        if (file) {
-            fprintf(file, "%d %s %s\n", dept->id, dept->name, dept->phone);
-            fflush(file);
-            fclose(file);
-            printf("\nDepartment added successfully!\n");
+        if (walLog(&departmentStorage, WAL_INSERT, NULL, dept) == 0) {
+            printf("\nFailed to add department. The change could not be logged.\n");
+            removeDepartment(dept);
         } else {
-            perror("Failed to write to Departments.txt");
+            printf("\nDepartment added successfully!\n");
         }
     }
 
@@ -212,29 +315,32 @@ void updateDepartment(int id, char *phone) {
             }
         }
 
-        strncpy(dept->phone, phone, 15);
-        printf("\nPhone number updated successfully.\n");
-
-        // Update file
-        FILE *file = fopen("data/Departments.txt", "r");
-        FILE *temp = fopen("data/Departments_temp.txt", "w");
-
-        if (file != NULL && temp != NULL) {
-            int curr_id;
-            char name[100], curr_phone[15];
+        Department *existing = searchDepartmentByPhone(phone);
+        if (existing != NULL && existing != dept) {
+            printf("Error: This phone number is already registered to another department.\n");
+            release_lock(3, EXCLUSIVE);
+            return;
+        }
 
-            while (fscanf(file, "%d %s %s\n", &curr_id, name, curr_phone) != EOF) {
-                if (curr_id == id) {
-                    fprintf(temp, "%d %s %s\n", id, name, phone);
-                } else {
-                    fprintf(temp, "%d %s %s\n", curr_id, name, curr_phone);
-                }
-            }
+        Department before = *dept;
+        strncpy(dept->phone, phone, 15);
 
-            fclose(file);
-            fclose(temp);
-            remove("data/Departments.txt");
-            rename("data/Departments_temp.txt", "data/Departments.txt");
+        // Re-key the phone index
+        if (!hashIndexInsert(&departmentPhoneIndex, hashIndexStringKey(dept->phone), (uintptr_t)dept)) {
+            *dept = before;
+            release_lock(3, EXCLUSIVE);
+            return;
+        }
+        hashIndexRemove(&departmentPhoneIndex, hashIndexStringKey(before.phone), (uintptr_t)dept);
+
+        // Log the change instead of rewriting the page file
+        if (walLog(&departmentStorage, WAL_UPDATE, &before, dept) == 0) {
+            hashIndexInsert(&departmentPhoneIndex, hashIndexStringKey(before.phone), (uintptr_t)dept);
+            hashIndexRemove(&departmentPhoneIndex, hashIndexStringKey(dept->phone), (uintptr_t)dept);
+            *dept = before;
+            printf("Error: The change could not be logged, the phone number was not updated.\n");
+        } else {
+            printf("\nPhone number updated successfully.\n");
         }
     } else {
         printf("Department not found.\n");
@@ -247,163 +353,127 @@ void updateDepartment(int id, char *phone) {
 void deleteDepartment(int id) {
     acquire_lock(3, EXCLUSIVE); // Lock for deleting a department
 
-    int index = hash(id);
-    while (departmentHashTable[index] != NULL) {
-        if (departmentHashTable[index]->occupied && departmentHashTable[index]->id == id) {
-            // Check for referential integrity
-            for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-                if (instructorHashTable[i] != NULL && instructorHashTable[i]->occupied &&
-                    instructorHashTable[i]->departmentId == id) {
-                    printf("Error: Cannot delete department - Instructors are assigned\n");
-                    release_lock(3, EXCLUSIVE); // Unlock if constraints not met
-                    return;
-                }
-                if (courseHashTable[i] != NULL && courseHashTable[i]->occupied &&
-                    courseHashTable[i]->departmentId == id) {
-                    printf("Error: Cannot delete department - Courses are assigned\n");
-                    release_lock(3, EXCLUSIVE); // Unlock if constraints not met
-                    return;
-                }
-                if (studentHashTable[i] != NULL && studentHashTable[i]->occupied &&
-                    studentHashTable[i]->departmentId == id) {
-                    printf("Error: Cannot delete department - Students are enrolled\n");
-                    release_lock(3, EXCLUSIVE); // Unlock if constraints not met
-                    return;
-                }
-            }
+    Department *dept = searchDepartmentById(id);
+    if (dept == NULL) {
+        printf("Department not found.\n");
+        release_lock(3, EXCLUSIVE);
+        return;
+    }
 
-            departmentHashTable[index]->occupied = 0;
-            printf("\nDepartment %s deleted successfully!\n", departmentHashTable[index]->name);
-
-            // Remove from mapping array
-            for (int i = 0; i < departmentMappingCount; i++) {
-                if (departmentNameMapping[i].id == id) {
-                    for (int j = i; j < departmentMappingCount - 1; j++) {
-                        departmentNameMapping[j] = departmentNameMapping[j + 1];
-                    }
-                    departmentMappingCount--;
-                    break;
-                }
-            }
+    // Check for referential integrity through the reference counts. Each
+    // count belongs to the referencing table, so it is read under that
+    // table's lock. Inserts there hold their table while checking ours, so
+    // these waits may be aborted to break the deadlock.
+    if (!acquire_lock_abortable(5, SHARED)) {
+        printf("Error: Instructors are locked by another user, try again.\n");
+        release_lock(3, EXCLUSIVE);
+        return;
+    }
+    size_t instructors = refIndexCount(&instructorsByDepartment, (uint64_t)id);
+    release_lock(5, SHARED);
+    if (instructors > 0) {
+        printf("Error: Cannot delete department - Instructors are assigned\n");
+        release_lock(3, EXCLUSIVE); // Unlock if constraints not met
+        return;
+    }
 
-            // Remove from ID array
-            int *found = bsearch(&id, departmentIdArray, departmentCounter, sizeof(int), compareDepartmentId);
-            if (found != NULL) {
-                memmove(found, found + 1, (--departmentCounter - (found - departmentIdArray)) * sizeof(int));
-            }
+    if (!acquire_lock_abortable(2, SHARED)) {
+        printf("Error: Courses are locked by another user, try again.\n");
+        release_lock(3, EXCLUSIVE);
+        return;
+    }
+    size_t courses = refIndexCount(&coursesByDepartment, (uint64_t)id);
+    release_lock(2, SHARED);
+    if (courses > 0) {
+        printf("Error: Cannot delete department - Courses are assigned\n");
+        release_lock(3, EXCLUSIVE); // Unlock if constraints not met
+        return;
+    }
 
-            // Update file
-            FILE *file = fopen("data/Departments.txt", "r");
-            FILE *temp = fopen("data/Departments_temp.txt", "w");
+    if (!acquire_lock_abortable(1, SHARED)) {
+        printf("Error: Students are locked by another user, try again.\n");
+        release_lock(3, EXCLUSIVE);
+        return;
+    }
+    size_t students = refIndexCount(&studentsByDepartment, (uint64_t)id);
+    release_lock(1, SHARED);
+    if (students > 0) {
+        printf("Error: Cannot delete department - Students are enrolled\n");
+        release_lock(3, EXCLUSIVE); // Unlock if constraints not met
+        return;
+    }
 
-            if (file != NULL && temp != NULL) {
-                int curr_id;
-                char name[100], phone[15];
+    if (walLog(&departmentStorage, WAL_DELETE, dept, NULL) == 0) {
+        printf("Error: The change could not be logged, the department was not deleted.\n");
+    } else {
+        printf("\nDepartment %s deleted successfully!\n", dept->name);
+        removeDepartment(dept);
+    }
 
-                while (fscanf(file, "%d %s %s\n", &curr_id, name, phone) != EOF) {
-                    if (curr_id != id) {
-                        fprintf(temp, "%d %s %s\n", curr_id, name, phone);
-                    }
-                }
+    release_lock(3, EXCLUSIVE); // Unlock after deletion
+}
 
-                fclose(file);
-                fclose(temp);
-                remove("data/Departments.txt");
-                rename("data/Departments_temp.txt", "data/Departments.txt");
-            }
+// Remove a department from the hash indexes and free it.
+void removeDepartment(Department *dept) {
+    int id = dept->id;
+    unindexDepartment(dept);
 
-            release_lock(3, EXCLUSIVE); // Unlock after deletion
-            return;
-        }
-        index = hash(index + 1);
+    if (btreeIndexRemove(&departmentIdTree, id)) {
+        departmentCounter--;
     }
-    printf("Department not found.\n");
-    release_lock(3, EXCLUSIVE);
+
+    free(dept);
 }
 
 // Search functions
 Department *searchDepartmentById(int id) {
 
-    int index = hash(id);
-    while (departmentHashTable[index] != NULL) {
-        if (departmentHashTable[index]->occupied && departmentHashTable[index]->id == id) {
-            return departmentHashTable[index];
-        }
-        index = hash(index + 1);
+    uintptr_t value;
+    if (hashIndexFind(&departmentIndex, (uint64_t)id, &value)) {
+        return (Department *)value;
     }
-
     return NULL;
 }
 
 Department *searchDepartmentByName(char name[]) {
-
-    for (int i = 0; i < departmentMappingCount; i++) {
-        if (strcmp(departmentNameMapping[i].name, name) == 0) {
-            return searchDepartmentById(departmentNameMapping[i].id);
-        }
+    uintptr_t value;
+    if (hashIndexFindMatch(&departmentNameIndex, hashIndexStringKey(name), departmentNameMatches, name, &value)) {
+        return (Department *)value;
     }
-
     return NULL;
 }
 
 Department *searchDepartmentByPhone(char phone[]) {
-
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (departmentHashTable[i] != NULL && departmentHashTable[i]->occupied &&
-            strcmp(departmentHashTable[i]->phone, phone) == 0) {
-            return departmentHashTable[i];
-        }
+    uintptr_t value;
+    if (hashIndexFindMatch(&departmentPhoneIndex, hashIndexStringKey(phone), departmentPhoneMatches, phone, &value)) {
+        return (Department *)value;
     }
-
     return NULL;
 }
 
-// Display functions
-void *printDepartment(void *arg) {
-    acquire_lock(3, SHARED); // Lock for reading
-
-    DepartmentThreadArg *threadArg = (DepartmentThreadArg *)arg;
-    Department *dept = threadArg->department;
-
-    // printf("Thread %lu is processing:\n", pthread_self());
-    printf("ID: %d Name: %s Phone: %s\n",
-           dept->id, dept->name, dept->phone);
+// Departments whose name starts with prefix, ignoring case, in name order
+int searchDepartmentsByNamePrefix(char prefix[], Department *results[], int limit) {
+    if (limit <= 0) return 0;
 
-    // Simulate processing time
-    sleep(1);
-
-    // printf("Thread %lu finished processing department: %s\n", pthread_self(), dept->name);
+    uintptr_t handles[limit];
+    size_t found = prefixIndexSearch(&departmentNamePrefixIndex, prefix, handles, (size_t)limit);
+    for (size_t i = 0; i < found; i++) {
+        results[i] = (Department *)handles[i];
+    }
+    return (int)found;
+}
 
-    release_lock(3, SHARED);
-    return NULL;
+// Display functions
+static int formatDepartmentRow(char *buffer, size_t size, const void *row) {
+    const Department *dept = (const Department *)row;
+    return snprintf(buffer, size, "ID: %d Name: %s Phone: %s\n", dept->id, dept->name, dept->phone);
 }
 
 // Function to display all departments
 void showAllDepartments() {
-
-        //  initDepartments();
-
     acquire_lock(3, SHARED); // Lock for reading
-
-
     printf("\nThere are currently %d department(s) in the database.\n", departmentCounter);
-
-    pthread_t threads[departmentCounter];
-    DepartmentThreadArg args[departmentCounter];
-    int threadIndex = 0;
-
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (departmentHashTable[i] != NULL && departmentHashTable[i]->occupied) {
-            args[threadIndex].department = departmentHashTable[i];
-            pthread_create(&threads[threadIndex], NULL, printDepartment, &args[threadIndex]);
-            threadIndex++;
-        }
-    }
-
-    for (int i = 0; i < threadIndex; i++) {
-        pthread_join(threads[i], NULL);
-    }
-
+    printRows(&departmentIdTree, formatDepartmentRow);
     release_lock(3, SHARED);
 }
 
@@ -524,6 +594,7 @@ void departmentMenu() {
         printf("6. Show Department Instructors\n");
         printf("7. Show Department Courses\n");
         printf("8. Show Department Students\n");
+        printf("9. Find Departments by Name Prefix\n");
         printf("0. Back to Main Menu\n");
         printf("Enter choice: ");
         
@@ -564,6 +635,15 @@ void departmentMenu() {
                     if (dept) showStudentsInDepartment(dept->id);
                 }
                 break;
+            case 9:
+                {
+                    char prefix[100];
+                    printf("Enter the start of the name: ");
+                    fgets(prefix, sizeof(prefix), stdin);
+                    prefix[strcspn(prefix, "\n")] = 0;
+                    showDepartmentNameSuggestions(prefix);
+                }
+                break;
             case 0:
                 break;
             default:
@@ -576,62 +656,93 @@ void departmentMenu() {
 void showInstructorsInDepartment(int departmentId) {
     acquire_lock(3, SHARED); // Lock for reading
 
+    // The roster is kept by the instructor table and changes under its lock
+    if (!acquire_lock_abortable(5, SHARED)) {
+        printf("Error: Instructors are locked by another user, try again.\n");
+        release_lock(3, SHARED);
+        return;
+    }
+
     printf("\nInstructors in Department %d:\n", departmentId);
     bool found = false;
 
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (instructorHashTable[i] != NULL && instructorHashTable[i]->occupied &&
-            instructorHashTable[i]->departmentId == departmentId) {
-            showInstructor(instructorHashTable[i]);
-            found = true;
-        }
+    const RefList *list = refIndexFind(&instructorsByDepartment, (uint64_t)departmentId);
+    for (size_t i = 0; list != NULL && i < list->count; i++) {
+        showInstructor((Instructor *)list->handles[i]);
+        found = true;
     }
 
     if (!found) {
         printf("No instructors found in this department.\n");
     }
 
+    release_lock(5, SHARED);
     release_lock(3, SHARED);
 }
 
 void showCoursesInDepartment(int departmentId) {
     acquire_lock(3, SHARED); // Lock for reading
 
+    if (!acquire_lock_abortable(2, SHARED)) {
+        printf("Error: Courses are locked by another user, try again.\n");
+        release_lock(3, SHARED);
+        return;
+    }
+
     printf("\nCourses in Department %d:\n", departmentId);
     bool found = false;
 
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (courseHashTable[i] != NULL && courseHashTable[i]->occupied &&
-            courseHashTable[i]->departmentId == departmentId) {
-            showCourse(courseHashTable[i]);
-            found = true;
-        }
+    const RefList *list = refIndexFind(&coursesByDepartment, (uint64_t)departmentId);
+    for (size_t i = 0; list != NULL && i < list->count; i++) {
+        showCourse((Course *)list->handles[i]);
+        found = true;
     }
 
     if (!found) {
         printf("No courses found in this department.\n");
     }
 
+    release_lock(2, SHARED);
     release_lock(3, SHARED);
 }
 
 void showStudentsInDepartment(int departmentId) {
     acquire_lock(3, SHARED); // Lock for reading
 
+    if (!acquire_lock_abortable(1, SHARED)) {
+        printf("Error: Students are locked by another user, try again.\n");
+        release_lock(3, SHARED);
+        return;
+    }
+
     printf("\nStudents in Department %d:\n", departmentId);
     bool found = false;
 
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (studentHashTable[i] != NULL && studentHashTable[i]->occupied &&
-            studentHashTable[i]->departmentId == departmentId) {
-            showStudent(studentHashTable[i]);
-            found = true;
-        }
+    const RefList *list = refIndexFind(&studentsByDepartment, (uint64_t)departmentId);
+    for (size_t i = 0; list != NULL && i < list->count; i++) {
+        showStudent((Student *)list->handles[i]);
+        found = true;
     }
 
     if (!found) {
         printf("No students found in this department.\n");
     }
 
+    release_lock(1, SHARED);
+    release_lock(3, SHARED);
+}
+
+void showDepartmentNameSuggestions(char prefix[]) {
+    Department *results[NAME_SUGGESTION_LIMIT];
+
+    acquire_lock(3, SHARED);
+    int found = searchDepartmentsByNamePrefix(prefix, results, NAME_SUGGESTION_LIMIT);
+    printf("\nDepartments matching \"%s\":\n", prefix);
+    for (int i = 0; i < found; i++) {
+        printf("ID: %d Name: %s\n", results[i]->id, results[i]->name);
+    }
+    if (found == 0) {
+        printf("No departments found.\n");
+    }
     release_lock(3, SHARED);
 }
@@ -2,61 +2,263 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <limits.h>
 #include <ctype.h>
 #include "../include/enrollment.h"
 #include "../include/student.h"
 #include "../include/course.h"
 #include "../include/common.h"
 #include "../include/lock_management.h"
+#include "../include/storage.h"
+#include "../include/wal.h"
+#include "../include/hash_index.h"
+#include "../include/ref_index.h"
+#include "../include/text_reader.h"
+#include "../include/row_printer.h"
+
+void removeEnrollment(Enrollment *enrollment);
+
+// Storage engine callbacks
+void loadEnrollmentRecord(const void *record, void *ctx);
+void *adoptEnrollmentRecord(const void *record);
+uint64_t enrollmentImageKey(int index, const void *record);
+bool parseEnrollmentText(const char *line, size_t length, void *record);
+void formatEnrollmentText(FILE *file, const void *record);
+void forEachEnrollment(void (*visit)(const void *record, void *ctx), void *ctx);
+void redoEnrollmentLog(int operation, const void *image);
 
 // Global variables
-Enrollment **enrollmentHashTable = NULL; // Dynamic hash table pointer
-int *enrollmentIdArray = NULL; // Dynamic array for enrollment IDs
+HashIndex enrollmentIndex; // Maps ID to enrollment record
+HashIndex enrollmentPairIndex; // Maps (student ID, course ID) to enrollment record
+RefIndex enrollmentsByStudent; // Maps student ID to its enrollments
+RefIndex enrollmentsByCourse; // Maps course ID to its enrollments
+BTreeIndex enrollmentIdTree; // Maps ID to enrollment record in ID order
 int enrollmentCounter = 0;
 
-// Comparison function for sorting enrollment IDs
-int compareEnrollmentId(const void *a, const void *b) {
-    return (*(int *)a - *(int *)b);
+// Inserts and deletes only lock their own row, so the indexes above are
+// changed under this mutex while the table is held INTENTION_EXCLUSIVE.
+// Under a SHARED or EXCLUSIVE table lock nobody else can change them.
+static pthread_mutex_t enrollmentIndexMutex = PTHREAD_MUTEX_INITIALIZER;
+
+StorageTable enrollmentStorage = {
+    .tableId = ENROLLMENT_TABLE_ID,
+    .name = "Enrollments",
+    .dataPath = "data/Enrollments.db",
+    .textPath = "data/Enrollments.txt",
+    .recordSize = sizeof(Enrollment),
+    .index = &enrollmentIndex,
+    .parseText = parseEnrollmentText,
+    .formatText = formatEnrollmentText,
+    .forEachRecord = forEachEnrollment,
+    .redoLog = redoEnrollmentLog,
+    .imagePath = "data/Enrollments.idx",
+    .imageIndexes = { &enrollmentIndex, &enrollmentPairIndex },
+    .imageIndexCount = 2,
+    .imageRefIndexes = { &enrollmentsByStudent, &enrollmentsByCourse },
+    .imageRefIndexCount = 2,
+    .imageKey = enrollmentImageKey,
+};
+
+// Key of the (student ID, course ID) index
+static uint64_t enrollmentPairKey(int studentId, int courseId) {
+    return ((uint64_t)(uint32_t)studentId << 32) | (uint32_t)courseId;
+}
+
+// Add an enrollment to every index, undoing the ones done so far on failure
+static bool indexEnrollment(Enrollment *enrollment) {
+    uintptr_t handle = (uintptr_t)enrollment;
+    uint64_t pairKey = enrollmentPairKey(enrollment->studentId, enrollment->courseId);
+
+    if (!hashIndexInsert(&enrollmentIndex, (uint64_t)enrollment->id, handle)) {
+        return false;
+    }
+    if (!hashIndexInsert(&enrollmentPairIndex, pairKey, handle)) {
+        hashIndexRemove(&enrollmentIndex, (uint64_t)enrollment->id, handle);
+        return false;
+    }
+    if (!refIndexAdd(&enrollmentsByStudent, (uint64_t)enrollment->studentId, handle)) {
+        hashIndexRemove(&enrollmentPairIndex, pairKey, handle);
+        hashIndexRemove(&enrollmentIndex, (uint64_t)enrollment->id, handle);
+        return false;
+    }
+    if (!refIndexAdd(&enrollmentsByCourse, (uint64_t)enrollment->courseId, handle)) {
+        refIndexRemove(&enrollmentsByStudent, (uint64_t)enrollment->studentId, handle);
+        hashIndexRemove(&enrollmentPairIndex, pairKey, handle);
+        hashIndexRemove(&enrollmentIndex, (uint64_t)enrollment->id, handle);
+        return false;
+    }
+    return true;
+}
+
+static void unindexEnrollment(Enrollment *enrollment) {
+    uintptr_t handle = (uintptr_t)enrollment;
+    hashIndexRemove(&enrollmentIndex, (uint64_t)enrollment->id, handle);
+    hashIndexRemove(&enrollmentPairIndex, enrollmentPairKey(enrollment->studentId, enrollment->courseId), handle);
+    refIndexRemove(&enrollmentsByStudent, (uint64_t)enrollment->studentId, handle);
+    refIndexRemove(&enrollmentsByCourse, (uint64_t)enrollment->courseId, handle);
 }
 
 // Initializing the enrollments
 void initEnrollments() {
-    // Allocating memory dynamically for the hash table
-    enrollmentHashTable = calloc(hashTableSize, sizeof(Enrollment *));
-    if (enrollmentHashTable == NULL) {
-        printf("Memory allocation failed for enrollment hash table.\n");
+    // Allocate the hash index
+    if (!hashIndexInit(&enrollmentIndex, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for enrollment hash index.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!hashIndexInit(&enrollmentPairIndex, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for enrollment pair index.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!refIndexInit(&enrollmentsByStudent, HASH_TABLE_SIZE) ||
+        !refIndexInit(&enrollmentsByCourse, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for enrollment reference indexes.\n");
         exit(EXIT_FAILURE);
     }
 
-    // Allocating memory dynamically for the ID array
-    enrollmentIdArray = malloc(hashTableSize * sizeof(int));
-    if (enrollmentIdArray == NULL) {
-        printf("Memory allocation failed for enrollment ID array.\n");
+    if (!btreeIndexInit(&enrollmentIdTree)) {
+        printf("Memory allocation failed for enrollment ID tree.\n");
         exit(EXIT_FAILURE);
     }
 
-    for (int i = 0; i < hashTableSize; i++) {
-        enrollmentIdArray[i] = -1;
+    // Load the page file in bulk. The snapshot image of the last checkpoint
+    // brings the hash and reference indexes prebuilt; without one the hash
+    // indexes are sized for every stored row up front. The ID tree is built
+    // once, after the scan.
+    if (storageOpen(&enrollmentStorage)) {
+        btreeIndexBeginBulk(&enrollmentIdTree);
+        if (!storageLoadImage(&enrollmentStorage, adoptEnrollmentRecord)) {
+            size_t rows = enrollmentStorage.header.recordCount;
+            if (!hashIndexReserve(&enrollmentIndex, rows) || !hashIndexReserve(&enrollmentPairIndex, rows)) {
+                printf("Memory allocation failed for enrollment indexes.\n");
+                exit(EXIT_FAILURE);
+            }
+            storageScan(&enrollmentStorage, loadEnrollmentRecord, NULL);
+        }
+        if (!btreeIndexEndBulk(&enrollmentIdTree)) {
+            printf("Failed to build the enrollment ID tree.\n");
+            exit(EXIT_FAILURE);
+        }
     }
+}
 
-    // getting the enrollments from file
-    FILE *file = fopen("data/Enrollments.txt", "r");
-    if (file != NULL) {
-        int id, studentId, courseId, status;
-        char grade[MAX_GRADE_LENGTH + 1];
+// Count the enrollments whose student or course does not exist, once after
+// loading
+void checkEnrollmentReferences() {
+    int dangling = 0;
+
+    acquire_lock(4, SHARED);
+    BTreeCursor cursor;
+    btreeIndexSeek(&enrollmentIdTree, INT_MIN, INT_MAX, &cursor);
+    while (btreeIndexNext(&cursor)) {
+        Enrollment *enrollment = (Enrollment *)cursor.value;
+        if (searchStudentById(enrollment->studentId) == NULL ||
+            searchCourseById(enrollment->courseId) == NULL) {
+            dangling++;
+        }
+    }
+    release_lock(4, SHARED);
 
-        while (fscanf(file, "%d %d %d %s %d\n", &id, &studentId, &courseId, grade, &status) != EOF) {
-            Enrollment *enrollment = malloc(sizeof(Enrollment));
-            enrollment->id = id;
-            enrollment->studentId = studentId;
-            enrollment->courseId = courseId;
-            strncpy(enrollment->grade, grade, MAX_GRADE_LENGTH + 1);
-            enrollment->status = (EnrollmentStatus)status;
-            enrollment->occupied = 1;
+    if (dangling > 0) {
+        printf("Warning: %d enrollment(s) refer to a missing student or course.\n", dangling);
+    }
+}
 
-            insertEnrollment(enrollment, true);
-        }
-        fclose(file);
+void loadEnrollmentRecord(const void *record, void *ctx) {
+    (void)ctx;
+    Enrollment *enrollment = malloc(sizeof(Enrollment));
+    if (enrollment == NULL) {
+        printf("Memory allocation failed for enrollment entry.\n");
+        return;
+    }
+    memcpy(enrollment, record, sizeof(Enrollment));
+    enrollment->occupied = 1;
+    insertEnrollment(enrollment, true);
+}
+
+// Loads an enrollment when starting from the snapshot image. Every index
+// but the ID tree comes from the image.
+void *adoptEnrollmentRecord(const void *record) {
+    Enrollment *enrollment = malloc(sizeof(Enrollment));
+    if (enrollment == NULL) {
+        printf("Memory allocation failed for enrollment entry.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(enrollment, record, sizeof(Enrollment));
+    enrollment->occupied = 1;
+
+    uintptr_t handle = (uintptr_t)enrollment;
+    if (!btreeIndexInsert(&enrollmentIdTree, enrollment->id, handle)) {
+        printf("Memory allocation failed for enrollment indexes.\n");
+        exit(EXIT_FAILURE);
+    }
+    enrollmentCounter++;
+    return enrollment;
+}
+
+// Keys of the image indexes: enrollmentStorage.imageIndexes, then imageRefIndexes
+uint64_t enrollmentImageKey(int index, const void *record) {
+    const Enrollment *enrollment = (const Enrollment *)record;
+    switch (index) {
+        case 0: return (uint64_t)enrollment->id;
+        case 1: return enrollmentPairKey(enrollment->studentId, enrollment->courseId);
+        case 2: return (uint64_t)enrollment->studentId;
+        default: return (uint64_t)enrollment->courseId;
+    }
+}
+
+bool parseEnrollmentText(const char *line, size_t length, void *record) {
+    Enrollment *enrollment = (Enrollment *)record;
+    int status;
+    TextFields fields;
+    textFieldsInit(&fields, line, length);
+    if (!textFieldInt(&fields, &enrollment->id) ||
+        !textFieldInt(&fields, &enrollment->studentId) ||
+        !textFieldInt(&fields, &enrollment->courseId)) {
+        return false;
+    }
+
+    // New enrollments have no grade yet, so only the status follows
+    if (textFieldsLeft(&fields) == 1) {
+        enrollment->grade[0] = '\0';
+    } else if (!textFieldString(&fields, enrollment->grade, sizeof(enrollment->grade))) {
+        return false;
+    }
+    if (!textFieldInt(&fields, &status)) {
+        return false;
+    }
+    enrollment->status = (EnrollmentStatus)status;
+    enrollment->occupied = 1;
+    return true;
+}
+
+void formatEnrollmentText(FILE *file, const void *record) {
+    const Enrollment *enrollment = (const Enrollment *)record;
+    fprintf(file, "%d %d %d %s %d\n",
+            enrollment->id, enrollment->studentId, enrollment->courseId,
+            enrollment->grade, enrollment->status);
+}
+
+void forEachEnrollment(void (*visit)(const void *record, void *ctx), void *ctx) {
+    acquire_lock(4, SHARED);
+    BTreeCursor cursor;
+    btreeIndexSeek(&enrollmentIdTree, INT_MIN, INT_MAX, &cursor);
+    while (btreeIndexNext(&cursor)) {
+        visit((const void *)cursor.value, ctx);
+    }
+    release_lock(4, SHARED);
+}
+
+// Replace or remove the enrollment with the logged key
+void redoEnrollmentLog(int operation, const void *image) {
+    int id;
+    memcpy(&id, image, sizeof(int));
+
+    Enrollment *existing = searchEnrollmentById(id);
+    if (existing != NULL) {
+        removeEnrollment(existing);
+    }
+    if (operation != WAL_DELETE) {
+        loadEnrollmentRecord(image, NULL);
     }
 }
 
@@ -75,281 +277,260 @@ bool validateEnrollmentData(Enrollment *enrollment) {
     return true;
 }
 
+// Adds a validated enrollment to every index, the caller holds
+// enrollmentIndexMutex or the whole table
+static bool addEnrollment(Enrollment *enrollment, bool isInit) {
+    // Check for duplicate ID since IDs should be unique
+    if (searchEnrollmentById(enrollment->id) != NULL) {
+        printf("\nFailed to add enrollment. An enrollment with ID %d already exists.\n", enrollment->id);
+        return false;
+    }
+
+    // A student can only be enrolled in a course once. Existing records are
+    // loaded as they are so nothing is lost at startup.
+    if (!isInit && searchEnrollmentByStudentAndCourse(enrollment->studentId, enrollment->courseId) != NULL) {
+        printf("\nFailed to add enrollment. Student %d is already enrolled in course %d.\n",
+               enrollment->studentId, enrollment->courseId);
+        return false;
+    }
+
+    // Insert into the hash and reference indexes
+    if (!indexEnrollment(enrollment)) {
+        return false;
+    }
+    enrollment->occupied = 1;
+
+    // Add to the ordered ID index
+    if (!btreeIndexInsert(&enrollmentIdTree, enrollment->id, (uintptr_t)enrollment)) {
+        unindexEnrollment(enrollment);
+        enrollment->occupied = 0;
+        return false;
+    }
+    enrollmentCounter++;
+    return true;
+}
+
+// Looks an enrollment up while other rows may be inserted or deleted
+static Enrollment *findEnrollment(int id) {
+    pthread_mutex_lock(&enrollmentIndexMutex);
+    Enrollment *enrollment = searchEnrollmentById(id);
+    pthread_mutex_unlock(&enrollmentIndexMutex);
+    return enrollment;
+}
+
+static Enrollment *findEnrollmentByStudentAndCourse(int studentId, int courseId) {
+    pthread_mutex_lock(&enrollmentIndexMutex);
+    Enrollment *enrollment = searchEnrollmentByStudentAndCourse(studentId, courseId);
+    pthread_mutex_unlock(&enrollmentIndexMutex);
+    return enrollment;
+}
+
 // Inserting new enrollment
 void insertEnrollment(Enrollment *enrollment, bool isInit) {
-    acquire_lock(4, EXCLUSIVE); // execlusive lock to the enrollment data
-
-    // Validate enrollment data if not during initialization
-    if (!isInit && !validateEnrollmentData(enrollment)) {
+    if (isInit) {
+        // Loading runs alone, the whole table is cheaper than a lock per row
+        acquire_lock(4, EXCLUSIVE);
+        addEnrollment(enrollment, true);
         release_lock(4, EXCLUSIVE);
         return;
     }
 
-    // Check for duplicate ID since IDs should be unique
-    if (bsearch(&(enrollment->id), enrollmentIdArray, enrollmentCounter, sizeof(int), compareEnrollmentId) != NULL) {
-        printf("\nFailed to add enrollment. An enrollment with ID %d already exists.\n", enrollment->id);
-        release_lock(4, EXCLUSIVE);
+    // The record is freed when it cannot be logged, so its keys are kept here
+    int enrollmentId = enrollment->id;
+    int studentId = enrollment->studentId;
+    int courseId = enrollment->courseId;
+
+    // Keep the student and the course from being deleted, and their indexes
+    // from being resized, until the enrollment is in. Students are locked
+    // before courses, and courses before enrollments, as deleteCourse and
+    // showCourseStats do.
+    if (!acquire_row_lock(1, studentId, SHARED)) {
+        printf("\nFailed to add enrollment. Student %d is locked by another user.\n", studentId);
         return;
     }
 
-    // Resizeing the ID array if necessary
-    if (enrollmentCounter == hashTableSize) {
-        int newSize = hashTableSize * 2;
-        int *newIdArray = realloc(enrollmentIdArray, newSize * sizeof(int));
-        if (newIdArray == NULL) {
-            printf("Error: Memory allocation failed for enrollment ID array resizing.\n");
-            release_lock(4, EXCLUSIVE);
-            return;
-        }
-        enrollmentIdArray = newIdArray;
+    if (!acquire_row_lock(2, courseId, SHARED)) {
+        printf("\nFailed to add enrollment. Course %d is locked by another user.\n", courseId);
+        release_row_lock(1, studentId, SHARED);
+        return;
     }
 
-    // Add ID to array and sort
-    enrollmentIdArray[enrollmentCounter++] = enrollment->id;
-    qsort(enrollmentIdArray, enrollmentCounter, sizeof(int), compareEnrollmentId);
+    // Lock only the new row, so enrollments into different courses go in
+    // side by side and share their log writes
+    if (!acquire_row_lock(4, enrollmentId, EXCLUSIVE)) {
+        printf("\nFailed to add enrollment. Enrollment %d is locked by another user.\n", enrollmentId);
+        release_row_lock(2, courseId, SHARED);
+        release_row_lock(1, studentId, SHARED);
+        return;
+    }
 
-    // Resizing the hash table if necessary
-    if ((float)enrollmentCounter / hashTableSize > 0.75) {
-        int newSize = hashTableSize * 2;
-        Enrollment **newHashTable = calloc(newSize, sizeof(Enrollment *));
-        if (newHashTable == NULL) {
-            printf("Error: Memory allocation failed during hash table resizing.\n");
-            release_lock(4, EXCLUSIVE);
-            return;
-        }
-        // here we have to rehash the elements
-        for (int i = 0; i < hashTableSize; i++) {
-            // we only need to rehash the occupied elements
-            if (enrollmentHashTable[i] != NULL && enrollmentHashTable[i]->occupied) {
-                int newIndex = enrollmentHashTable[i]->id % newSize;
-                while (newHashTable[newIndex] != NULL) {
-                    newIndex = (newIndex + 1) % newSize;
-                }
-                newHashTable[newIndex] = enrollmentHashTable[i];
-            }
-        }
-        // Free the old hash table and update the pointer and size
-        free(enrollmentHashTable);
-        enrollmentHashTable = newHashTable;
-        hashTableSize = newSize;
-    }
-
-    // Inserting enrollment into hash table
-    int index = hash(enrollment->id) % hashTableSize;
-    int originalIndex = index;
-    while (enrollmentHashTable[index] != NULL) {
-        if (enrollmentHashTable[index]->occupied == 0) { // to reuse a deleted slot
-            free(enrollmentHashTable[index]);
-            break;
-        }
-        index = (index + 1) % hashTableSize;
-        if (index == originalIndex) { 
-            printf("Error: Hash table is full. Cannot insert enrollment.\n");
-            release_lock(4, EXCLUSIVE);
-            return;
-        }
+    // Validate enrollment data
+    if (!validateEnrollmentData(enrollment)) {
+        release_row_lock(4, enrollmentId, EXCLUSIVE);
+        release_row_lock(2, courseId, SHARED);
+        release_row_lock(1, studentId, SHARED);
+        return;
     }
-    enrollmentHashTable[index] = enrollment;
-    enrollment->occupied = 1;
 
-    // Store enrollment to file if not during initialization
-    if (!isInit) {
-        FILE *file = fopen("data/Enrollments.txt", "a");
-        if (file != NULL) {
-            fprintf(file, "%d %d %d %s %d\n",
-                    enrollment->id, enrollment->studentId, enrollment->courseId,
-                    enrollment->grade, enrollment->status);
-            fflush(file);
-            fclose(file);
-            printf("\nEnrollment added successfully!\n");
+    pthread_mutex_lock(&enrollmentIndexMutex);
+    bool added = addEnrollment(enrollment, false);
+    pthread_mutex_unlock(&enrollmentIndexMutex);
+
+    // Log the new enrollment, one that cannot be logged would be lost on restart
+    if (added) {
+        if (walLog(&enrollmentStorage, WAL_INSERT, NULL, enrollment) == 0) {
+            printf("\nFailed to add enrollment. The change could not be logged.\n");
+            pthread_mutex_lock(&enrollmentIndexMutex);
+            removeEnrollment(enrollment);
+            pthread_mutex_unlock(&enrollmentIndexMutex);
         } else {
-            perror("Failed to write to Enrollments.txt");
+            printf("\nEnrollment added successfully!\n");
         }
     }
 
-    release_lock(4, EXCLUSIVE); // Release the lock
+    release_row_lock(4, enrollmentId, EXCLUSIVE); // Release the lock
+    release_row_lock(2, courseId, SHARED);
+    release_row_lock(1, studentId, SHARED);
 }
 
 
 // Update grade
 void updateGrade(int enrollmentId, char grade[]) {
-    acquire_lock(4, EXCLUSIVE); // Locking to update
+    if (!acquire_row_lock(4, enrollmentId, EXCLUSIVE)) { // Only this row changes, no index does
+        printf("Error: Enrollment %d is locked by another user.\n", enrollmentId);
+        return;
+    }
 
-    Enrollment *enrollment = searchEnrollmentById(enrollmentId);
+    Enrollment *enrollment = findEnrollment(enrollmentId);
     if (enrollment != NULL) {
         if (!validateGrade(grade)) {
             printf("Error: Invalid grade format\n");
-            release_lock(4, EXCLUSIVE); // we release the lock if validation fails
+            release_row_lock(4, enrollmentId, EXCLUSIVE); // we release the lock if validation fails
             return;
         }
 
+        Enrollment before = *enrollment;
         strncpy(enrollment->grade, grade, MAX_GRADE_LENGTH);
         enrollment->grade[MAX_GRADE_LENGTH] = '\0';
-        printf("\nGrade updated successfully.\n");
-
-        // Update file
-        FILE *file = fopen("data/Enrollments.txt", "r");
-        FILE *temp = fopen("data/Enrollments_temp.txt", "w");
-
-        if (file != NULL && temp != NULL) {
-            int curr_id, studentId, courseId;
-            char curr_grade[MAX_GRADE_LENGTH + 1];
-            int status;
-
-            while (fscanf(file, "%d %d %d %s %d\n", &curr_id, &studentId, &courseId, 
-                         curr_grade, &status) != EOF) {
-                if (curr_id == enrollmentId) {
-                    fprintf(temp, "%d %d %d %s %d\n", curr_id, studentId, courseId,
-                            grade, status);
-                } else {
-                    fprintf(temp, "%d %d %d %s %d\n", curr_id, studentId, courseId,
-                            curr_grade, status);
-                }
-            }
 
-            fclose(file);
-            fclose(temp);
-            remove("data/Enrollments.txt");
-            rename("data/Enrollments_temp.txt", "data/Enrollments.txt");
+        // Log the change instead of rewriting the page file
+        if (walLog(&enrollmentStorage, WAL_UPDATE, &before, enrollment) == 0) {
+            *enrollment = before;
+            printf("Error: The change could not be logged, the grade was not updated.\n");
+        } else {
+            printf("\nGrade updated successfully.\n");
         }
     } else {
         printf("Enrollment not found.\n");
     }
 
-    release_lock(4, EXCLUSIVE); // Unlock after updating grade
+    release_row_lock(4, enrollmentId, EXCLUSIVE); // Unlock after updating grade
 }
 
 // Update status
 void updateStatus(int enrollmentId, EnrollmentStatus status) {
-    acquire_lock(4, EXCLUSIVE); // Lock for updating status
+    if (!acquire_row_lock(4, enrollmentId, EXCLUSIVE)) { // Only this row changes, no index does
+        printf("Error: Enrollment %d is locked by another user.\n", enrollmentId);
+        return;
+    }
 
-    Enrollment *enrollment = searchEnrollmentById(enrollmentId);
+    Enrollment *enrollment = findEnrollment(enrollmentId);
     if (enrollment != NULL) {
         if (!validateStatus(status)) {
             printf("Error: Invalid status\n");
-            release_lock(4, EXCLUSIVE); // relese the lock if validation fails
+            release_row_lock(4, enrollmentId, EXCLUSIVE); // relese the lock if validation fails
             return;
         }
 
+        Enrollment before = *enrollment;
         enrollment->status = status;
-        printf("\nStatus updated successfully.\n");
-
-        // Update file
-        FILE *file = fopen("data/Enrollments.txt", "r");
-        FILE *temp = fopen("data/Enrollments_temp.txt", "w");
-
-        if (file != NULL && temp != NULL) {
-            int curr_id, studentId, courseId;
-            char grade[MAX_GRADE_LENGTH + 1];
-            int curr_status;
-
-            while (fscanf(file, "%d %d %d %s %d\n", &curr_id, &studentId, &courseId, 
-                         grade, &curr_status) != EOF) {
-                if (curr_id == enrollmentId) {
-                    fprintf(temp, "%d %d %d %s %d\n", curr_id, studentId, courseId,
-                            grade, status);
-                } else {
-                    fprintf(temp, "%d %d %d %s %d\n", curr_id, studentId, courseId,
-                            grade, curr_status);
-                }
-            }
 
-            fclose(file);
-            fclose(temp);
-            remove("data/Enrollments.txt");
-            rename("data/Enrollments_temp.txt", "data/Enrollments.txt");
+        // Log the change instead of rewriting the page file
+        if (walLog(&enrollmentStorage, WAL_UPDATE, &before, enrollment) == 0) {
+            *enrollment = before;
+            printf("Error: The change could not be logged, the status was not updated.\n");
+        } else {
+            printf("\nStatus updated successfully.\n");
         }
     } else {
         printf("Enrollment not found.\n");
     }
 
-    release_lock(4, EXCLUSIVE); // Unlock after updating status
+    release_row_lock(4, enrollmentId, EXCLUSIVE); // Unlock after updating status
 }
 
 // Delete enrollment
 void deleteEnrollment(int enrollmentId) {
-    acquire_lock(4, EXCLUSIVE); // Lock for deleting an enrollment
+    if (!acquire_row_lock(4, enrollmentId, EXCLUSIVE)) { // Lock for deleting an enrollment
+        printf("Error: Enrollment %d is locked by another user.\n", enrollmentId);
+        return;
+    }
 
-    int index = hash(enrollmentId);
-    while (enrollmentHashTable[index] != NULL) {
-        if (enrollmentHashTable[index]->occupied && enrollmentHashTable[index]->id == enrollmentId) {
-            enrollmentHashTable[index]->occupied = 0;
+    Enrollment *enrollment = findEnrollment(enrollmentId);
+    if (enrollment != NULL) {
+        if (walLog(&enrollmentStorage, WAL_DELETE, enrollment, NULL) == 0) {
+            printf("Error: The change could not be logged, the enrollment was not deleted.\n");
+        } else {
             printf("\nEnrollment deleted successfully!\n");
+            pthread_mutex_lock(&enrollmentIndexMutex);
+            removeEnrollment(enrollment);
+            pthread_mutex_unlock(&enrollmentIndexMutex);
+        }
+    } else {
+        printf("Enrollment not found.\n");
+    }
 
-            // Remove from ID array
-            int *found = bsearch(&enrollmentId, enrollmentIdArray, enrollmentCounter, sizeof(int), compareEnrollmentId);
-            if (found != NULL) {
-                memmove(found, found + 1, (--enrollmentCounter - (found - enrollmentIdArray)) * sizeof(int));
-            }
-
-            // Update file
-            FILE *file = fopen("data/Enrollments.txt", "r");
-            FILE *temp = fopen("data/Enrollments_temp.txt", "w");
-
-            if (file != NULL && temp != NULL) {
-                int curr_id, studentId, courseId;
-                char grade[MAX_GRADE_LENGTH + 1];
-                int status;
-
-                while (fscanf(file, "%d %d %d %s %d\n", &curr_id, &studentId, &courseId, 
-                             grade, &status) != EOF) {
-                    if (curr_id != enrollmentId) {
-                        fprintf(temp, "%d %d %d %s %d\n", curr_id, studentId, courseId,
-                                grade, status);
-                    }
-                }
+    release_row_lock(4, enrollmentId, EXCLUSIVE); // Unlock after deletion
+}
 
-                fclose(file);
-                fclose(temp);
-                remove("data/Enrollments.txt");
-                rename("data/Enrollments_temp.txt", "data/Enrollments.txt");
-            }
+// Remove an enrollment from the hash indexes and free it.
+void removeEnrollment(Enrollment *enrollment) {
+    int id = enrollment->id;
+    unindexEnrollment(enrollment);
 
-            release_lock(4, EXCLUSIVE); // Unlock after deletion
-            return;
-        }
-        index = hash(index + 1);
+    if (btreeIndexRemove(&enrollmentIdTree, id)) {
+        enrollmentCounter--;
     }
-    printf("Enrollment not found.\n");
-    release_lock(4, EXCLUSIVE);
+
+    free(enrollment);
 }
 
 // Search functions
 Enrollment *searchEnrollmentById(int id) {
-    int index = hash(id);
-    while (enrollmentHashTable[index] != NULL) {
-        if (enrollmentHashTable[index]->occupied && enrollmentHashTable[index]->id == id) {
-            Enrollment *result = enrollmentHashTable[index];
-            return result;
-        }
-        index = hash(index + 1);
+    uintptr_t value;
+    if (hashIndexFind(&enrollmentIndex, (uint64_t)id, &value)) {
+        return (Enrollment *)value;
     }
     return NULL;
 }
 
 Enrollment *searchEnrollmentByStudentAndCourse(int studentId, int courseId) {
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (enrollmentHashTable[i] != NULL && enrollmentHashTable[i]->occupied &&
-            enrollmentHashTable[i]->studentId == studentId &&
-            enrollmentHashTable[i]->courseId == courseId) {
-            Enrollment *result = enrollmentHashTable[i];
-            return result;
-        }
+    uintptr_t value;
+    if (hashIndexFind(&enrollmentPairIndex, enrollmentPairKey(studentId, courseId), &value)) {
+        return (Enrollment *)value;
     }
     return NULL;
 }
 
+// Caller holds the enrollment lock
+static void printEnrollment(const Enrollment *enrollment) {
+    printf("\n*****************\n");
+    printf("Enrollment ID: %d\n", enrollment->id);
+    printf("Student ID: %d\n", enrollment->studentId);
+    printf("Course ID: %d\n", enrollment->courseId);
+    printf("Grade: %s\n", enrollment->grade);
+    printf("Status: %s\n", getStatusString(enrollment->status));
+}
+
 void searchEnrollmentsByStudent(int studentId) {
     acquire_lock(4, SHARED); // Acquire a shared lock before reading
     printf("\nEnrollments for Student %d:\n", studentId);
     bool found = false;
 
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (enrollmentHashTable[i] != NULL && enrollmentHashTable[i]->occupied &&
-            enrollmentHashTable[i]->studentId == studentId) {
-            showEnrollment(enrollmentHashTable[i]);
-            found = true;
-        }
+    const RefList *list = refIndexFind(&enrollmentsByStudent, (uint64_t)studentId);
+    for (size_t i = 0; list != NULL && i < list->count; i++) {
+        printEnrollment((const Enrollment *)list->handles[i]);
+        found = true;
     }
 
     if (!found) {
@@ -363,12 +544,10 @@ void searchEnrollmentsByCourse(int courseId) {
     printf("\nEnrollments for Course %d:\n", courseId);
     bool found = false;
 
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (enrollmentHashTable[i] != NULL && enrollmentHashTable[i]->occupied &&
-            enrollmentHashTable[i]->courseId == courseId) {
-            showEnrollment(enrollmentHashTable[i]);
-            found = true;
-        }
+    const RefList *list = refIndexFind(&enrollmentsByCourse, (uint64_t)courseId);
+    for (size_t i = 0; list != NULL && i < list->count; i++) {
+        printEnrollment((const Enrollment *)list->handles[i]);
+        found = true;
     }
 
     if (!found) {
@@ -377,38 +556,17 @@ void searchEnrollmentsByCourse(int courseId) {
     release_lock(4, SHARED); // Release the lock after reading
 }
 
-void *printEnrollment(void *arg) {
-    EnrollmentThreadArg *threadArg = (EnrollmentThreadArg *)arg;
-    Enrollment *enrollment = threadArg->enrollment;
-
-    acquire_lock(4, SHARED); // Acquire a shared lock before displaying
-    printf("Enrollment ID: %d Student ID: %d Course ID: %d Grade: %s Status: %s\n",
-       enrollment->id, enrollment->studentId, enrollment->courseId,
-       enrollment->grade, getStatusString(enrollment->status));
-    release_lock(4, SHARED); // Release the lock after displaying
-
-    return NULL;
+static int formatEnrollmentRow(char *buffer, size_t size, const void *row) {
+    const Enrollment *enrollment = (const Enrollment *)row;
+    return snprintf(buffer, size, "Enrollment ID: %d Student ID: %d Course ID: %d Grade: %s Status: %s\n",
+                    enrollment->id, enrollment->studentId, enrollment->courseId,
+                    enrollment->grade, getStatusString(enrollment->status));
 }
 
 void showAllEnrollments() {
     acquire_lock(4, SHARED); // Acquire a shared lock before displaying
     printf("\nThere are currently %d enrollment(s) in the database.\n", enrollmentCounter);
-
-    pthread_t threads[enrollmentCounter];
-    EnrollmentThreadArg args[enrollmentCounter];
-    int threadIndex = 0;
-
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (enrollmentHashTable[i] != NULL && enrollmentHashTable[i]->occupied) {
-            args[threadIndex].enrollment = enrollmentHashTable[i];
-            pthread_create(&threads[threadIndex], NULL, printEnrollment, &args[threadIndex]);
-            threadIndex++;
-        }
-    }
-
-    for (int i = 0; i < threadIndex; i++) {
-        pthread_join(threads[i], NULL);
-    }
+    printRows(&enrollmentIdTree, formatEnrollmentRow);
     release_lock(4, SHARED); // Release the lock after displaying
 }
 
@@ -418,14 +576,20 @@ void showEnrollment(Enrollment *enrollment) {
         return;
     }
 
-    acquire_lock(4, SHARED); // Acquire a shared lock before displaying
-    printf("\n*****************\n");
-    printf("Enrollment ID: %d\n", enrollment->id);
-    printf("Student ID: %d\n", enrollment->studentId);
-    printf("Course ID: %d\n", enrollment->courseId);
-    printf("Grade: %s\n", enrollment->grade);
-    printf("Status: %s\n", getStatusString(enrollment->status));
-    release_lock(4, SHARED); // Release the lock after displaying
+    int id = enrollment->id;
+    if (!acquire_row_lock(4, id, SHARED)) { // Lock the row before displaying
+        printf("Error: Enrollment %d is locked by another user.\n", id);
+        return;
+    }
+
+    // It may have been deleted before the lock was granted
+    enrollment = findEnrollment(id);
+    if (enrollment != NULL) {
+        printEnrollment(enrollment);
+    } else {
+        printf("Enrollment not found.\n");
+    }
+    release_row_lock(4, id, SHARED); // Release the lock after displaying
 }
 
 
@@ -450,7 +614,7 @@ Enrollment *selectEnrollmentMenu() {
                 printf("Enter Enrollment ID: ");
                 scanf("%d", &id);
                 getchar();
-                enrollment = searchEnrollmentById(id);
+                enrollment = findEnrollment(id);
                 break;
             case 2:
                 printf("Enter Student ID: ");
@@ -459,7 +623,7 @@ Enrollment *selectEnrollmentMenu() {
                 printf("Enter Course ID: ");
                 scanf("%d", &courseId);
                 getchar();
-                enrollment = searchEnrollmentByStudentAndCourse(studentId, courseId);
+                enrollment = findEnrollmentByStudentAndCourse(studentId, courseId);
                 break;
             case 0:
                 return NULL;
@@ -658,15 +822,19 @@ void showCourseStats(int courseId) {
     int totalDropped = 0;
     int totalCompleted = 0;
 
-    acquire_lock(4, SHARED); // Lock the enrollment resource for shared reading
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (enrollmentHashTable[i] != NULL && enrollmentHashTable[i]->occupied &&
-            enrollmentHashTable[i]->courseId == courseId) {
-            switch(enrollmentHashTable[i]->status) {
-                case ENROLLED: totalEnrolled++; break;
-                case DROPPED: totalDropped++; break;
-                case COMPLETED: totalCompleted++; break;
-            }
+    // Second lock while the course is held, may be aborted to break a deadlock
+    if (!acquire_lock_abortable(4, SHARED)) {
+        release_lock(2, SHARED);
+        printf("Error: Enrollments are locked by another user, try again.\n");
+        return;
+    }
+    const RefList *list = refIndexFind(&enrollmentsByCourse, (uint64_t)courseId);
+    for (size_t i = 0; list != NULL && i < list->count; i++) {
+        Enrollment *entry = (Enrollment *)list->handles[i];
+        switch(entry->status) {
+            case ENROLLED: totalEnrolled++; break;
+            case DROPPED: totalDropped++; break;
+            case COMPLETED: totalCompleted++; break;
         }
     }
     release_lock(4, SHARED); // Release the enrollment lock
@@ -682,10 +850,10 @@ void showCourseStats(int courseId) {
 int getEnrollmentCount(int courseId) {
     int count = 0;
     acquire_lock(4, SHARED); // Lock the enrollment resource for shared reading
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (enrollmentHashTable[i] != NULL && enrollmentHashTable[i]->occupied &&
-            enrollmentHashTable[i]->courseId == courseId &&
-            enrollmentHashTable[i]->status == ENROLLED) {
+    const RefList *list = refIndexFind(&enrollmentsByCourse, (uint64_t)courseId);
+    for (size_t i = 0; list != NULL && i < list->count; i++) {
+        Enrollment *entry = (Enrollment *)list->handles[i];
+        if (entry->status == ENROLLED) {
             count++;
         }
     }
@@ -0,0 +1,490 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/hash_index.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_INDEX_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define CTRL_EMPTY ((int8_t)-128)
+#define CTRL_DELETED ((int8_t)-2)
+
+static uint64_t hashKey(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+// FNV-1a, hashKey mixes the result again
+uint64_t hashIndexStringKey(const char *text) {
+    uint64_t key = 0xcbf29ce484222325ULL;
+    for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; c++) {
+        key ^= *c;
+        key *= 0x100000001b3ULL;
+    }
+    return key;
+}
+
+// Full slots hold the low 7 bits of the hash, so they are never negative
+static int8_t hashFragment(uint64_t hash) {
+    return (int8_t)(hash & 0x7F);
+}
+
+static int lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanForward(&bit, mask);
+    return (int)bit;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Bit i is set when control byte i of the group equals fragment
+static uint32_t matchFragment(const int8_t *group, int8_t fragment) {
+#ifdef HASH_INDEX_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(fragment)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < HASH_INDEX_GROUP_WIDTH; i++) {
+        if (group[i] == fragment) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+static uint32_t matchEmpty(const int8_t *group) {
+    return matchFragment(group, CTRL_EMPTY);
+}
+
+// Empty and deleted are the only negative control bytes
+static uint32_t matchFree(const int8_t *group) {
+#ifdef HASH_INDEX_SSE2
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < HASH_INDEX_GROUP_WIDTH; i++) {
+        if (group[i] < 0) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+static void setCtrl(HashIndexTable *table, size_t slot, int8_t value) {
+    table->ctrl[slot] = value;
+    if (slot < HASH_INDEX_GROUP_WIDTH) {
+        table->ctrl[table->capacity + slot] = value;
+    }
+}
+
+// Up to 7/8 of the slots may be filled
+static size_t maxLoad(size_t capacity) {
+    return capacity - capacity / 8;
+}
+
+static bool allocateTable(HashIndexTable *table, size_t capacity) {
+    table->ctrl = malloc(capacity + HASH_INDEX_GROUP_WIDTH);
+    table->keys = malloc(capacity * sizeof(uint64_t));
+    table->values = malloc(capacity * sizeof(uintptr_t));
+    if (table->ctrl == NULL || table->keys == NULL || table->values == NULL) {
+        free(table->ctrl);
+        free(table->keys);
+        free(table->values);
+        memset(table, 0, sizeof(HashIndexTable));
+        return false;
+    }
+
+    memset(table->ctrl, CTRL_EMPTY, capacity + HASH_INDEX_GROUP_WIDTH);
+    table->capacity = capacity;
+    table->tombstones = 0;
+    table->growthLeft = maxLoad(capacity);
+    return true;
+}
+
+static void freeTable(HashIndexTable *table) {
+    free(table->ctrl);
+    free(table->keys);
+    free(table->values);
+    memset(table, 0, sizeof(HashIndexTable));
+}
+
+// First empty or deleted slot on the probe sequence of hash
+static size_t findFreeSlot(const HashIndexTable *table, uint64_t hash) {
+    size_t mask = table->capacity - 1;
+    size_t position = (size_t)(hash >> 7) & mask;
+
+    while (1) {
+        uint32_t candidates = matchFree(table->ctrl + position);
+        if (candidates != 0) {
+            return (position + lowestBit(candidates)) & mask;
+        }
+        position = (position + HASH_INDEX_GROUP_WIDTH) & mask;
+    }
+}
+
+static void placeEntry(HashIndexTable *table, uint64_t hash, uint64_t key, uintptr_t value) {
+    size_t slot = findFreeSlot(table, hash);
+    if (table->ctrl[slot] == CTRL_EMPTY) {
+        table->growthLeft--;
+    } else {
+        table->tombstones--;
+    }
+    setCtrl(table, slot, hashFragment(hash));
+    table->keys[slot] = key;
+    table->values[slot] = value;
+}
+
+// Find the slot of key whose value passes match (any value when NULL), or -1
+static long findSlot(const HashIndexTable *table, uint64_t hash, uint64_t key, HashIndexMatch match, const void *ctx) {
+    if (table->capacity == 0) return -1;
+
+    int8_t fragment = hashFragment(hash);
+    size_t mask = table->capacity - 1;
+    size_t position = (size_t)(hash >> 7) & mask;
+
+    for (size_t probed = 0; probed < table->capacity; probed += HASH_INDEX_GROUP_WIDTH) {
+        const int8_t *group = table->ctrl + position;
+
+        uint32_t matches = matchFragment(group, fragment);
+        while (matches != 0) {
+            size_t slot = (position + lowestBit(matches)) & mask;
+            if (table->keys[slot] == key && (match == NULL || match(table->values[slot], ctx))) {
+                return (long)slot;
+            }
+            matches &= matches - 1;
+        }
+
+        // An empty slot ends the probe sequence, the key would have gone there
+        if (matchEmpty(group) != 0) {
+            return -1;
+        }
+        position = (position + HASH_INDEX_GROUP_WIDTH) & mask;
+    }
+    return -1;
+}
+
+// Move up to slots old slots into the current table. Moved slots are marked
+// deleted, not empty, so probes for keys further along still get past them.
+static void migrate(HashIndex *index, size_t slots) {
+    HashIndexTable *old = &index->old;
+    if (old->capacity == 0) return;
+
+    size_t end = index->migrated + slots;
+    if (end > old->capacity) end = old->capacity;
+
+    for (; index->migrated < end; index->migrated++) {
+        size_t slot = index->migrated;
+        if (old->ctrl[slot] >= 0) {
+            placeEntry(&index->current, hashKey(old->keys[slot]), old->keys[slot], old->values[slot]);
+            setCtrl(old, slot, CTRL_DELETED);
+        }
+    }
+
+    if (index->migrated == old->capacity) {
+        freeTable(old);
+        index->migrated = 0;
+    }
+}
+
+// Smallest capacity whose load leaves room for as many inserts as entries
+static size_t fitCapacity(size_t entries) {
+    size_t capacity = HASH_INDEX_MIN_CAPACITY;
+    while (maxLoad(capacity) / 2 < entries) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+// Start moving to a table of the given capacity. The live entries use at most
+// half of the new table's load, and the step is sized so the old table is
+// drained within the other half, even when shrinking.
+static bool startResize(HashIndex *index, size_t capacity) {
+    // A resize that is still running is finished first
+    migrate(index, index->old.capacity);
+
+    HashIndexTable resized;
+    if (!allocateTable(&resized, capacity)) {
+        return false;
+    }
+    index->old = index->current;
+    index->current = resized;
+    index->migrated = 0;
+
+    size_t operations = resized.growthLeft / 2;
+    index->migrateStep = (index->old.capacity + operations - 1) / operations;
+    if (index->migrateStep < HASH_INDEX_MIGRATE_STEP) {
+        index->migrateStep = HASH_INDEX_MIGRATE_STEP;
+    }
+    return true;
+}
+
+// Size the index for expected entries without growing
+bool hashIndexInit(HashIndex *index, size_t expected) {
+    size_t capacity = HASH_INDEX_MIN_CAPACITY;
+    while (maxLoad(capacity) < expected) {
+        capacity *= 2;
+    }
+    memset(index, 0, sizeof(HashIndex));
+    index->migrateStep = HASH_INDEX_MIGRATE_STEP;
+    return allocateTable(&index->current, capacity);
+}
+
+// Grow ahead of a bulk load so that expected entries fit without a rehash.
+// An empty index is simply reallocated; one with entries starts an ordinary
+// incremental resize.
+bool hashIndexReserve(HashIndex *index, size_t expected) {
+    size_t capacity = HASH_INDEX_MIN_CAPACITY;
+    while (maxLoad(capacity) < expected) {
+        capacity *= 2;
+    }
+    if (capacity <= index->current.capacity) {
+        return true;
+    }
+    if (index->count > 0 || index->old.capacity > 0) {
+        return startResize(index, capacity);
+    }
+
+    HashIndexTable resized;
+    if (!allocateTable(&resized, capacity)) {
+        return false;
+    }
+    freeTable(&index->current);
+    index->current = resized;
+    return true;
+}
+
+void hashIndexFree(HashIndex *index) {
+    freeTable(&index->current);
+    freeTable(&index->old);
+    memset(index, 0, sizeof(HashIndex));
+}
+
+bool hashIndexInsert(HashIndex *index, uint64_t key, uintptr_t value) {
+    migrate(index, index->migrateStep);
+
+    // Out of empty slots: grow, or just drop the tombstones when they are
+    // what filled the table up
+    HashIndexTable *table = &index->current;
+    if (table->growthLeft == 0) {
+        size_t capacity = index->count >= maxLoad(table->capacity) / 2 ? table->capacity * 2 : table->capacity;
+        if (!startResize(index, capacity)) {
+            printf("Error: Memory allocation failed during hash index resizing.\n");
+            return false;
+        }
+        migrate(index, index->migrateStep);
+    }
+
+    placeEntry(&index->current, hashKey(key), key, value);
+    index->count++;
+    return true;
+}
+
+bool hashIndexFind(const HashIndex *index, uint64_t key, uintptr_t *value) {
+    return hashIndexFindMatch(index, key, NULL, NULL, value);
+}
+
+// Entries not migrated yet are still found in the old table
+bool hashIndexFindMatch(const HashIndex *index, uint64_t key, HashIndexMatch match, const void *ctx,
+                        uintptr_t *value) {
+    uint64_t hash = hashKey(key);
+    const HashIndexTable *table = &index->current;
+    long slot = findSlot(table, hash, key, match, ctx);
+    if (slot < 0) {
+        table = &index->old;
+        slot = findSlot(table, hash, key, match, ctx);
+    }
+    if (slot < 0) return false;
+
+    if (value != NULL) *value = table->values[slot];
+    return true;
+}
+
+static bool sameValue(uintptr_t value, const void *ctx) {
+    return value == *(const uintptr_t *)ctx;
+}
+
+// Remove the entry holding both key and value
+bool hashIndexRemove(HashIndex *index, uint64_t key, uintptr_t value) {
+    migrate(index, index->migrateStep);
+
+    uint64_t hash = hashKey(key);
+    HashIndexTable *table = &index->current;
+    long slot = findSlot(table, hash, key, sameValue, &value);
+    if (slot < 0) {
+        table = &index->old;
+        slot = findSlot(table, hash, key, sameValue, &value);
+    }
+    if (slot < 0) return false;
+
+    setCtrl(table, (size_t)slot, CTRL_DELETED);
+    table->tombstones++;
+    index->count--;
+
+    // Compact once tombstones pile up. The rebuild runs incrementally like a
+    // resize, a failed allocation just leaves the tombstones for later.
+    HashIndexTable *current = &index->current;
+    if (index->old.capacity == 0 &&
+        current->tombstones * 100 > current->capacity * HASH_INDEX_MAX_TOMBSTONE_PERCENT) {
+        startResize(index, fitCapacity(index->count));
+    }
+    return true;
+}
+
+// Walks the current table, then whatever is left of the old one
+bool hashIndexNext(const HashIndex *index, HashIndexCursor *cursor) {
+    size_t total = index->current.capacity + index->old.capacity;
+    while (cursor->position < total) {
+        size_t position = cursor->position++;
+        const HashIndexTable *table = &index->current;
+        if (position >= table->capacity) {
+            position -= table->capacity;
+            table = &index->old;
+        }
+        if (table->ctrl[position] >= 0) {
+            cursor->key = table->keys[position];
+            cursor->value = table->values[position];
+            return true;
+        }
+    }
+    return false;
+}
+
+// Groups probed from the home position of key to its slot
+static size_t probeLength(const HashIndexTable *table, size_t slot) {
+    size_t mask = table->capacity - 1;
+    size_t home = (size_t)(hashKey(table->keys[slot]) >> 7) & mask;
+    return ((slot - home) & mask) / HASH_INDEX_GROUP_WIDTH + 1;
+}
+
+void hashIndexGetStats(const HashIndex *index, HashIndexStats *stats) {
+    const HashIndexTable *tables[2] = { &index->current, &index->old };
+    size_t probes = 0;
+
+    memset(stats, 0, sizeof(HashIndexStats));
+    stats->entries = index->count;
+    for (int t = 0; t < 2; t++) {
+        const HashIndexTable *table = tables[t];
+        stats->capacity += table->capacity;
+        stats->tombstones += table->tombstones;
+        for (size_t slot = 0; slot < table->capacity; slot++) {
+            if (table->ctrl[slot] >= 0) {
+                probes += probeLength(table, slot);
+            }
+        }
+    }
+    if (stats->entries > 0) {
+        stats->averageProbe = (double)probes / stats->entries;
+    }
+}
+
+// Image layout: the header, capacity + HASH_INDEX_GROUP_WIDTH control bytes,
+// the keys, then one ordinal per slot. Sections are padded to 8 bytes.
+typedef struct {
+    uint64_t capacity;
+    uint64_t count;
+} HashIndexImageHeader;
+
+static size_t padImage(size_t bytes) {
+    return (bytes + 7) & ~(size_t)7;
+}
+
+static size_t imageSize(size_t capacity) {
+    return sizeof(HashIndexImageHeader) + padImage(capacity + HASH_INDEX_GROUP_WIDTH) +
+           capacity * sizeof(uint64_t) + padImage(capacity * sizeof(uint32_t));
+}
+
+// Only a settled index has an image, one still migrating is refused
+bool hashIndexWriteImage(const HashIndex *index, FILE *file) {
+    const HashIndexTable *table = &index->current;
+    if (index->old.capacity > 0) return false;
+
+    uint32_t *ordinals = calloc(table->capacity, sizeof(uint32_t));
+    if (ordinals == NULL) return false;
+    for (size_t slot = 0; slot < table->capacity; slot++) {
+        if (table->ctrl[slot] >= 0) {
+            if (table->values[slot] > UINT32_MAX) {
+                free(ordinals);
+                return false;
+            }
+            ordinals[slot] = (uint32_t)table->values[slot];
+        }
+    }
+
+    HashIndexImageHeader header = { table->capacity, index->count };
+    static const unsigned char padding[8] = {0};
+    size_t ctrlBytes = table->capacity + HASH_INDEX_GROUP_WIDTH;
+    size_t ordinalBytes = table->capacity * sizeof(uint32_t);
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(table->ctrl, 1, ctrlBytes, file) == ctrlBytes &&
+              fwrite(padding, 1, padImage(ctrlBytes) - ctrlBytes, file) == padImage(ctrlBytes) - ctrlBytes &&
+              fwrite(table->keys, sizeof(uint64_t), table->capacity, file) == table->capacity &&
+              fwrite(ordinals, 1, ordinalBytes, file) == ordinalBytes &&
+              fwrite(padding, 1, padImage(ordinalBytes) - ordinalBytes, file) == padImage(ordinalBytes) - ordinalBytes;
+    free(ordinals);
+    return ok;
+}
+
+size_t hashIndexLoadImage(HashIndex *index, const unsigned char *image, size_t size,
+                          const uintptr_t *handles, size_t handleCount) {
+    HashIndexImageHeader header;
+    if (size < sizeof(header)) return 0;
+    memcpy(&header, image, sizeof(header));
+
+    size_t capacity = (size_t)header.capacity;
+    if (capacity < HASH_INDEX_MIN_CAPACITY || (capacity & (capacity - 1)) != 0 ||
+        capacity > size || imageSize(capacity) > size || header.count > maxLoad(capacity)) {
+        return 0;
+    }
+
+    const int8_t *ctrl = (const int8_t *)(image + sizeof(header));
+    const unsigned char *keys = image + sizeof(header) + padImage(capacity + HASH_INDEX_GROUP_WIDTH);
+    const uint32_t *ordinals = (const uint32_t *)(keys + capacity * sizeof(uint64_t));
+
+    HashIndexTable table;
+    if (!allocateTable(&table, capacity)) return 0;
+
+    // Control bytes and keys are taken as they are, only the values are
+    // relocated. The control tail is mirrored again rather than trusted.
+    size_t count = 0;
+    size_t tombstones = 0;
+    bool valid = true;
+    memcpy(table.ctrl, ctrl, capacity);
+    memcpy(table.ctrl + capacity, ctrl, HASH_INDEX_GROUP_WIDTH);
+    memcpy(table.keys, keys, capacity * sizeof(uint64_t));
+    for (size_t slot = 0; valid && slot < capacity; slot++) {
+        int8_t control = table.ctrl[slot];
+        if (control >= 0) {
+            valid = ordinals[slot] < handleCount;
+            if (valid) table.values[slot] = handles[ordinals[slot]];
+            count++;
+        } else if (control == CTRL_DELETED) {
+            tombstones++;
+        } else {
+            valid = control == CTRL_EMPTY;
+        }
+    }
+    if (!valid || count != header.count || count + tombstones > maxLoad(capacity)) {
+        freeTable(&table);
+        return 0;
+    }
+    table.tombstones = tombstones;
+    table.growthLeft = maxLoad(capacity) - count - tombstones;
+
+    freeTable(&index->current);
+    freeTable(&index->old);
+    index->current = table;
+    index->migrated = 0;
+    index->migrateStep = HASH_INDEX_MIGRATE_STEP;
+    index->count = count;
+    return imageSize(capacity);
+}
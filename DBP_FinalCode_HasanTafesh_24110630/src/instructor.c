@@ -1,228 +1,489 @@
 #include "../include/instructor.h"
 #include "../include/department.h"
+#include "../include/course.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <pthread.h>
+#include <limits.h>
 #include <ctype.h>
 #include "../include/lock_management.h"
 #include "../include/common.h"
+#include "../include/storage.h"
+#include "../include/wal.h"
+#include "../include/hash_index.h"
+#include "../include/text_reader.h"
+#include "../include/row_printer.h"
+
+void removeInstructor(Instructor *inst);
+int findFreePhoneNumberSlot();
+
+// Storage engine callbacks
+void loadInstructorRecord(const void *record, void *ctx);
+void *adoptInstructorRecord(const void *record);
+uint64_t instructorImageKey(int index, const void *record);
+void loadPhoneNumberRecord(const void *record, void *ctx);
+bool parseInstructorText(const char *line, size_t length, void *record);
+void formatInstructorText(FILE *file, const void *record);
+void forEachInstructor(void (*visit)(const void *record, void *ctx), void *ctx);
+void redoInstructorLog(int operation, const void *image);
+bool parsePhoneNumberText(const char *line, size_t length, void *record);
+void formatPhoneNumberText(FILE *file, const void *record);
+void forEachPhoneNumber(void (*visit)(const void *record, void *ctx), void *ctx);
+void redoPhoneNumberLog(int operation, const void *image);
 
 // Global variables
-Instructor **instructorHashTable = NULL; // Dynamic hash table pointer
-InstructorNameIdMapping instructorNameIdMapping[NAME_MAPPING_SIZE];
+HashIndex instructorIndex; // Maps ID to instructor record
+RefIndex instructorsByDepartment; // Maps department ID to its instructors
+HashIndex instructorEmailIndex; // Maps email to instructor record, unique
+HashIndex instructorNameIndex; // Maps (first name, last name) to instructor records
+PrefixIndex instructorNamePrefixIndex; // Full names in order, for prefix searches
 InstructorPhoneNumber *instructorPhoneNumbers = NULL; // Dynamic phone number array
-int *instructorIdArray = NULL;
-int instructorMappingCount = 0;
+BTreeIndex instructorIdTree; // Maps ID to instructor record in ID order
 int instructorCounter = 0;
 int nextPhoneNumberId = 1;
+int phoneNumberCapacity = HASH_TABLE_SIZE * MAX_PHONE_NUMBERS;
+
+StorageTable instructorStorage = {
+    .tableId = INSTRUCTOR_TABLE_ID,
+    .name = "Instructors",
+    .dataPath = "data/Instructors.db",
+    .textPath = "data/Instructors.txt",
+    .recordSize = sizeof(Instructor),
+    .index = &instructorIndex,
+    .parseText = parseInstructorText,
+    .formatText = formatInstructorText,
+    .forEachRecord = forEachInstructor,
+    .redoLog = redoInstructorLog,
+    .imagePath = "data/Instructors.idx",
+    .imageIndexes = { &instructorIndex, &instructorEmailIndex, &instructorNameIndex },
+    .imageIndexCount = 3,
+    .imageRefIndexes = { &instructorsByDepartment },
+    .imageRefIndexCount = 1,
+    .imageKey = instructorImageKey,
+};
+
+StorageTable phoneNumberStorage = {
+    .tableId = INSTRUCTOR_PHONE_TABLE_ID,
+    .name = "InstructorPhones",
+    .dataPath = "data/instructor_phones.db",
+    .textPath = "data/instructor_phones.txt",
+    .recordSize = sizeof(InstructorPhoneNumber),
+    .parseText = parsePhoneNumberText,
+    .formatText = formatPhoneNumberText,
+    .forEachRecord = forEachPhoneNumber,
+    .redoLog = redoPhoneNumberLog,
+};
 
 // Initialize instructors
 void initInstructors() {
-    // Allocate memory for the hash table
-    instructorHashTable = calloc(hashTableSize, sizeof(Instructor *));
-    if (instructorHashTable == NULL) {
-        printf("Memory allocation failed for instructor hash table.\n");
+    // Allocate the hash index
+    if (!hashIndexInit(&instructorIndex, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for instructor hash index.\n");
         exit(EXIT_FAILURE);
     }
+    if (!refIndexInit(&instructorsByDepartment, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for instructor department index.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!hashIndexInit(&instructorEmailIndex, HASH_TABLE_SIZE) ||
+        !hashIndexInit(&instructorNameIndex, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for instructor email and name indexes.\n");
+        exit(EXIT_FAILURE);
+    }
+    prefixIndexInit(&instructorNamePrefixIndex);
 
     // Allocate memory for phone numbers
-    instructorPhoneNumbers = malloc(hashTableSize * MAX_PHONE_NUMBERS * sizeof(InstructorPhoneNumber));
+    instructorPhoneNumbers = malloc(phoneNumberCapacity * sizeof(InstructorPhoneNumber));
     if (instructorPhoneNumbers == NULL) {
         printf("Memory allocation failed for instructor phone numbers.\n");
         exit(EXIT_FAILURE);
     }
-    for (int i = 0; i < hashTableSize * MAX_PHONE_NUMBERS; i++) {
+    for (int i = 0; i < phoneNumberCapacity; i++) {
         instructorPhoneNumbers[i].id = 0;
         instructorPhoneNumbers[i].instructorId = 0;
     }
 
-    // Allocate memory for the ID array
-    instructorIdArray = malloc(hashTableSize * sizeof(int));
-    if (instructorIdArray == NULL) {
-        printf("Memory allocation failed for instructor ID array.\n");
+    if (!btreeIndexInit(&instructorIdTree)) {
+        printf("Memory allocation failed for instructor ID tree.\n");
         exit(EXIT_FAILURE);
     }
-    for (int i = 0; i < hashTableSize; i++) {
-        instructorIdArray[i] = -1;
-    }
-
-    // Load instructors from file
-    FILE *file = fopen("data/Instructors.txt", "r");
-    if (file != NULL) {
-        int id, departmentId;
-        char firstName[50], lastName[50], email[100];
-        while (fscanf(file, "%d %s %s %s %d\n", &id, firstName, lastName, email, &departmentId) != EOF) {
-            Instructor *inst = malloc(sizeof(Instructor));
-            inst->id = id;
-            strncpy(inst->firstName, firstName, 50);
-            strncpy(inst->lastName, lastName, 50);
-            strncpy(inst->email, email, 100);
-            inst->departmentId = departmentId;
-            inst->occupied = 1;
-            insertInstructor(inst, true);
-        }
-        fclose(file);
-    }
-
-    // Load phone numbers from file
-    file = fopen("data/instructor_phones.txt", "r");
-    if (file != NULL) {
-        int id, instructorId;
-        char phone[15];
-        while (fscanf(file, "%d %d %s\n", &id, &instructorId, phone) != EOF) {
-            for (int i = 0; i < hashTableSize * MAX_PHONE_NUMBERS; i++) {
-                if (instructorPhoneNumbers[i].id == 0) {
-                    instructorPhoneNumbers[i].id = id;
-                    instructorPhoneNumbers[i].instructorId = instructorId;
-                    strncpy(instructorPhoneNumbers[i].phone, phone, 15);
-                    if (id >= nextPhoneNumberId) nextPhoneNumberId = id + 1;
-                    break;
-                }
+
+    // Load the page file in bulk. The snapshot image of the last checkpoint
+    // brings the hash and reference indexes prebuilt; without one the hash
+    // indexes are sized for every stored row up front. The ID tree is built
+    // once, after the scan.
+    if (storageOpen(&instructorStorage)) {
+        btreeIndexBeginBulk(&instructorIdTree);
+        if (!storageLoadImage(&instructorStorage, adoptInstructorRecord)) {
+            size_t rows = instructorStorage.header.recordCount;
+            if (!hashIndexReserve(&instructorIndex, rows) || !hashIndexReserve(&instructorEmailIndex, rows) ||
+                !hashIndexReserve(&instructorNameIndex, rows)) {
+                printf("Memory allocation failed for instructor indexes.\n");
+                exit(EXIT_FAILURE);
             }
+            storageScan(&instructorStorage, loadInstructorRecord, NULL);
+        }
+        if (!btreeIndexEndBulk(&instructorIdTree)) {
+            printf("Failed to build the instructor ID tree.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Load phone numbers from the page file
+    if (storageOpen(&phoneNumberStorage)) {
+        storageScan(&phoneNumberStorage, loadPhoneNumberRecord, NULL);
+    }
+}
+
+// Count the instructors whose department does not exist, once after loading
+void checkInstructorReferences()
+{
+    int dangling = 0;
+
+    acquire_lock(5, SHARED);
+    BTreeCursor cursor;
+    btreeIndexSeek(&instructorIdTree, INT_MIN, INT_MAX, &cursor);
+    while (btreeIndexNext(&cursor))
+    {
+        Instructor *inst = (Instructor *)cursor.value;
+        if (searchDepartmentById(inst->departmentId) == NULL)
+        {
+            dangling++;
+        }
+    }
+    release_lock(5, SHARED);
+
+    if (dangling > 0)
+    {
+        printf("Warning: %d instructor(s) refer to a missing department.\n", dangling);
+    }
+}
+
+void loadInstructorRecord(const void *record, void *ctx) {
+    (void)ctx;
+    Instructor *inst = malloc(sizeof(Instructor));
+    if (inst == NULL) {
+        printf("Memory allocation failed for instructor entry.\n");
+        return;
+    }
+    memcpy(inst, record, sizeof(Instructor));
+    inst->occupied = 1;
+    insertInstructor(inst, true);
+}
+
+// Returns a free phone number slot, doubling the array when all are in use.
+// Moving the array is only safe while table 5 is held EXCLUSIVE or before
+// the checkpoint thread starts.
+int findFreePhoneNumberSlot() {
+    for (int i = 0; i < phoneNumberCapacity; i++) {
+        if (instructorPhoneNumbers[i].id == 0) {
+            return i;
+        }
+    }
+
+    int newCapacity = phoneNumberCapacity * 2;
+    InstructorPhoneNumber *newPhoneNumbers = realloc(instructorPhoneNumbers, newCapacity * sizeof(InstructorPhoneNumber));
+    if (newPhoneNumbers == NULL) {
+        printf("Error: Memory allocation failed for instructor phone numbers resizing.\n");
+        return -1;
+    }
+    for (int i = phoneNumberCapacity; i < newCapacity; i++) {
+        newPhoneNumbers[i].id = 0;
+        newPhoneNumbers[i].instructorId = 0;
+    }
+
+    int slot = phoneNumberCapacity;
+    instructorPhoneNumbers = newPhoneNumbers;
+    phoneNumberCapacity = newCapacity;
+    return slot;
+}
+
+void loadPhoneNumberRecord(const void *record, void *ctx) {
+    (void)ctx;
+    const InstructorPhoneNumber *phone = (const InstructorPhoneNumber *)record;
+    int slot = findFreePhoneNumberSlot();
+    if (slot >= 0) {
+        instructorPhoneNumbers[slot] = *phone;
+        if (phone->id >= nextPhoneNumberId) nextPhoneNumberId = phone->id + 1;
+    }
+}
+
+bool parseInstructorText(const char *line, size_t length, void *record) {
+    Instructor *inst = (Instructor *)record;
+    TextFields fields;
+    textFieldsInit(&fields, line, length);
+    if (!textFieldInt(&fields, &inst->id) ||
+        !textFieldString(&fields, inst->firstName, sizeof(inst->firstName)) ||
+        !textFieldString(&fields, inst->lastName, sizeof(inst->lastName)) ||
+        !textFieldString(&fields, inst->email, sizeof(inst->email)) ||
+        !textFieldInt(&fields, &inst->departmentId)) {
+        return false;
+    }
+    inst->occupied = 1;
+    return true;
+}
+
+void formatInstructorText(FILE *file, const void *record) {
+    const Instructor *inst = (const Instructor *)record;
+    fprintf(file, "%d %s %s %s %d\n",
+            inst->id, inst->firstName, inst->lastName,
+            inst->email, inst->departmentId);
+}
+
+void forEachInstructor(void (*visit)(const void *record, void *ctx), void *ctx) {
+    acquire_lock(5, SHARED);
+    BTreeCursor cursor;
+    btreeIndexSeek(&instructorIdTree, INT_MIN, INT_MAX, &cursor);
+    while (btreeIndexNext(&cursor)) {
+        visit((const void *)cursor.value, ctx);
+    }
+    release_lock(5, SHARED);
+}
+
+// Replace or remove the instructor with the logged key
+void redoInstructorLog(int operation, const void *image) {
+    int id;
+    memcpy(&id, image, sizeof(int));
+
+    Instructor *existing = searchInstructorById(id);
+    if (existing != NULL) {
+        removeInstructor(existing);
+    }
+    if (operation != WAL_DELETE) {
+        loadInstructorRecord(image, NULL);
+    }
+}
+
+bool parsePhoneNumberText(const char *line, size_t length, void *record) {
+    InstructorPhoneNumber *phone = (InstructorPhoneNumber *)record;
+    TextFields fields;
+    textFieldsInit(&fields, line, length);
+    return textFieldInt(&fields, &phone->id) &&
+           textFieldInt(&fields, &phone->instructorId) &&
+           textFieldString(&fields, phone->phone, sizeof(phone->phone));
+}
+
+void formatPhoneNumberText(FILE *file, const void *record) {
+    const InstructorPhoneNumber *phone = (const InstructorPhoneNumber *)record;
+    fprintf(file, "%d %d %s\n", phone->id, phone->instructorId, phone->phone);
+}
+
+void forEachPhoneNumber(void (*visit)(const void *record, void *ctx), void *ctx) {
+    acquire_lock(5, SHARED);
+    for (int i = 0; i < phoneNumberCapacity; i++) {
+        if (instructorPhoneNumbers[i].id != 0) {
+            visit(&instructorPhoneNumbers[i], ctx);
+        }
+    }
+    release_lock(5, SHARED);
+}
+
+// Replace or remove the phone number with the logged key
+void redoPhoneNumberLog(int operation, const void *image) {
+    const InstructorPhoneNumber *phone = (const InstructorPhoneNumber *)image;
+
+    for (int i = 0; i < phoneNumberCapacity; i++) {
+        if (instructorPhoneNumbers[i].id == phone->id) {
+            instructorPhoneNumbers[i].id = 0;
+            instructorPhoneNumbers[i].instructorId = 0;
+            break;
         }
-        fclose(file);
+    }
+    if (operation != WAL_DELETE) {
+        loadPhoneNumberRecord(image, NULL);
     }
 }
 
+static bool instructorEmailMatches(uintptr_t value, const void *email)
+{
+    return strcmp(((Instructor *)value)->email, (const char *)email) == 0;
+}
 
+// Key and matcher of the name index, several instructors may share a name
+typedef struct {
+    const char *firstName;
+    const char *lastName;
+} InstructorNameQuery;
 
-int compareInstructorName(const void *a, const void *b)
+static uint64_t instructorNameKey(const char *firstName, const char *lastName)
 {
-    return strcmp(((InstructorNameIdMapping *)a)->firstName,
-                 ((InstructorNameIdMapping *)b)->firstName);
+    return hashIndexStringKey(firstName) * 31 + hashIndexStringKey(lastName);
 }
 
-int compareInstructorId(const void *a, const void *b)
+static bool instructorNameMatches(uintptr_t value, const void *ctx)
 {
-    return (*(int *)a - *(int *)b);
+    const Instructor *inst = (const Instructor *)value;
+    const InstructorNameQuery *query = (const InstructorNameQuery *)ctx;
+    return strcmp(inst->firstName, query->firstName) == 0 &&
+           strcmp(inst->lastName, query->lastName) == 0;
 }
 
-void storeInstructor(Instructor *inst)
+// "first last", the key of the prefix index
+static void instructorFullName(const Instructor *inst, char fullName[], size_t size)
 {
-    FILE *file = fopen("data/Instructors.txt", "a");
-    if (file != NULL)
-    {
-        fprintf(file, "%d %s %s %s %d\n", 
-                inst->id, inst->firstName, inst->lastName,
-                inst->email, inst->departmentId);
-        fflush(file);
-        fclose(file);
+    snprintf(fullName, size, "%s %s", inst->firstName, inst->lastName);
+}
+
+// Add an instructor to every index, undoing the ones done so far on failure
+static bool indexInstructor(Instructor *inst)
+{
+    uintptr_t handle = (uintptr_t)inst;
+    char fullName[sizeof(inst->firstName) + sizeof(inst->lastName)];
+    instructorFullName(inst, fullName, sizeof(fullName));
+
+    if (!hashIndexInsert(&instructorIndex, (uint64_t)inst->id, handle)) {
+        return false;
     }
-    else
-    {
-        perror("Failed to write to file.");
+    if (!refIndexAdd(&instructorsByDepartment, (uint64_t)inst->departmentId, handle)) {
+        hashIndexRemove(&instructorIndex, (uint64_t)inst->id, handle);
+        return false;
+    }
+    if (!hashIndexInsert(&instructorEmailIndex, hashIndexStringKey(inst->email), handle)) {
+        refIndexRemove(&instructorsByDepartment, (uint64_t)inst->departmentId, handle);
+        hashIndexRemove(&instructorIndex, (uint64_t)inst->id, handle);
+        return false;
+    }
+    if (!hashIndexInsert(&instructorNameIndex, instructorNameKey(inst->firstName, inst->lastName), handle)) {
+        hashIndexRemove(&instructorEmailIndex, hashIndexStringKey(inst->email), handle);
+        refIndexRemove(&instructorsByDepartment, (uint64_t)inst->departmentId, handle);
+        hashIndexRemove(&instructorIndex, (uint64_t)inst->id, handle);
+        return false;
+    }
+    if (!prefixIndexInsert(&instructorNamePrefixIndex, fullName, handle)) {
+        hashIndexRemove(&instructorNameIndex, instructorNameKey(inst->firstName, inst->lastName), handle);
+        hashIndexRemove(&instructorEmailIndex, hashIndexStringKey(inst->email), handle);
+        refIndexRemove(&instructorsByDepartment, (uint64_t)inst->departmentId, handle);
+        hashIndexRemove(&instructorIndex, (uint64_t)inst->id, handle);
+        return false;
     }
+    return true;
 }
 
-void storeInstructorPhoneNumber(InstructorPhoneNumber *phone)
+static void unindexInstructor(Instructor *inst)
 {
-    FILE *file = fopen("data/instructor_phones.txt", "a");
-    if (file != NULL)
-    {
-        fprintf(file, "%d %d %s\n", 
-                phone->id, phone->instructorId, phone->phone);
-        fflush(file);
-        fclose(file);
+    uintptr_t handle = (uintptr_t)inst;
+    char fullName[sizeof(inst->firstName) + sizeof(inst->lastName)];
+    instructorFullName(inst, fullName, sizeof(fullName));
+    hashIndexRemove(&instructorIndex, (uint64_t)inst->id, handle);
+    refIndexRemove(&instructorsByDepartment, (uint64_t)inst->departmentId, handle);
+    hashIndexRemove(&instructorEmailIndex, hashIndexStringKey(inst->email), handle);
+    hashIndexRemove(&instructorNameIndex, instructorNameKey(inst->firstName, inst->lastName), handle);
+    prefixIndexRemove(&instructorNamePrefixIndex, fullName, handle);
+}
+
+// Loads an instructor when starting from the snapshot image. Its hash and
+// department indexes come from the image, the name prefix index and the ID
+// tree are filled here.
+void *adoptInstructorRecord(const void *record)
+{
+    Instructor *inst = malloc(sizeof(Instructor));
+    if (inst == NULL) {
+        printf("Memory allocation failed for instructor entry.\n");
+        exit(EXIT_FAILURE);
     }
-    else
-    {
-        perror("Failed to write phone number to file.");
+    memcpy(inst, record, sizeof(Instructor));
+    inst->occupied = 1;
+
+    uintptr_t handle = (uintptr_t)inst;
+    char fullName[sizeof(inst->firstName) + sizeof(inst->lastName)];
+    instructorFullName(inst, fullName, sizeof(fullName));
+    if (!prefixIndexInsert(&instructorNamePrefixIndex, fullName, handle) ||
+        !btreeIndexInsert(&instructorIdTree, inst->id, handle)) {
+        printf("Memory allocation failed for instructor indexes.\n");
+        exit(EXIT_FAILURE);
+    }
+    instructorCounter++;
+    return inst;
+}
+
+// Keys of the image indexes: instructorStorage.imageIndexes, then imageRefIndexes
+uint64_t instructorImageKey(int index, const void *record)
+{
+    const Instructor *inst = (const Instructor *)record;
+    switch (index) {
+        case 0: return (uint64_t)inst->id;
+        case 1: return hashIndexStringKey(inst->email);
+        case 2: return instructorNameKey(inst->firstName, inst->lastName);
+        default: return (uint64_t)inst->departmentId;
     }
 }
 
+// Log a new record, false when it could not be logged
+bool storeInstructor(Instructor *inst)
+{
+    return walLog(&instructorStorage, WAL_INSERT, NULL, inst) != 0;
+}
+
+bool storeInstructorPhoneNumber(InstructorPhoneNumber *phone)
+{
+    return walLog(&phoneNumberStorage, WAL_INSERT, NULL, phone) != 0;
+}
+
 
 
 // Insert instructor
 void insertInstructor(Instructor *inst, bool isInit) {
     acquire_lock(5, EXCLUSIVE);
 
-    // Validate department reference
-    if (!isInit && searchDepartmentById(inst->departmentId) == NULL) {
-        printf("Error: Department %d does not exist.\n", inst->departmentId);
-        release_lock(5, EXCLUSIVE);
-        return;
+    // Validate department reference, under the department lock so a
+    // deleteDepartment waiting on our table is aborted instead
+    if (!isInit) {
+        if (!acquire_lock_abortable(3, SHARED)) {
+            printf("Error: Departments are locked by another user, try again.\n");
+            release_lock(5, EXCLUSIVE);
+            return;
+        }
+        bool departmentFound = searchDepartmentById(inst->departmentId) != NULL;
+        release_lock(3, SHARED);
+        if (!departmentFound) {
+            printf("Error: Department %d does not exist.\n", inst->departmentId);
+            release_lock(5, EXCLUSIVE);
+            return;
+        }
     }
 
     // Check for duplicate ID
-    if (bsearch(&(inst->id), instructorIdArray, instructorCounter, sizeof(int), compareInstructorId) != NULL) {
+    if (searchInstructorById(inst->id) != NULL) {
         printf("Error: An instructor with ID %d already exists.\n", inst->id);
         release_lock(5, EXCLUSIVE);
         return;
     }
 
-    // Resize hash table if load factor exceeds threshold
-    if ((float)instructorCounter / hashTableSize > 0.75) {
-        int newSize = hashTableSize * 2;
-        Instructor **newTable = calloc(newSize, sizeof(Instructor *));
-        if (!newTable) {
-            printf("Error: Memory allocation failed during hash table resizing.\n");
-            release_lock(5, EXCLUSIVE);
-            return;
-        }
-
-        for (int i = 0; i < hashTableSize; i++) {
-            if (instructorHashTable[i] && instructorHashTable[i]->occupied) {
-                int newIndex = instructorHashTable[i]->id % newSize;
-                while (newTable[newIndex]) newIndex = (newIndex + 1) % newSize;
-                newTable[newIndex] = instructorHashTable[i];
-            }
-        }
-
-        free(instructorHashTable);
-        instructorHashTable = newTable;
-        hashTableSize = newSize;
+    // Check for unique email, existing records are loaded as they are
+    if (!isInit && searchInstructorByEmail(inst->email) != NULL) {
+        printf("Error: An instructor with this email already exists.\n");
+        release_lock(5, EXCLUSIVE);
+        return;
     }
 
-    // Insert into hash table
-    int index = hash(inst->id) % hashTableSize;
-    int originalIndex = index;
-    while (instructorHashTable[index] != NULL) {
-        if (instructorHashTable[index]->occupied == 0) {
-            free(instructorHashTable[index]);
-            instructorHashTable[index] = inst;
-            instructorHashTable[index]->occupied = 1;
-            break;
-        }
-        index = (index + 1) % hashTableSize;
-        if (index == originalIndex) {
-            printf("Error: Hash table is full.\n");
-            release_lock(5, EXCLUSIVE);
-            return;
-        }
-    }
-    if (instructorHashTable[index] == NULL) {
-        instructorHashTable[index] = inst;
-        instructorHashTable[index]->occupied = 1;
+    // Insert into the hash and reference indexes
+    if (!indexInstructor(inst)) {
+        release_lock(5, EXCLUSIVE);
+        return;
     }
+    inst->occupied = 1;
 
-    if (instructorCounter == HASH_TABLE_SIZE) {
-        int *newIdArray = realloc(instructorIdArray, HASH_TABLE_SIZE * 2 * sizeof(int));
-        if (newIdArray == NULL) {
-            printf("Error: Memory allocation failed for instructorIdArray resizing.\n");
-            release_lock(5, EXCLUSIVE);
-            return;
-        }
-        instructorIdArray = newIdArray;
+    // Add to the ordered ID index
+    if (!btreeIndexInsert(&instructorIdTree, inst->id, (uintptr_t)inst)) {
+        unindexInstructor(inst);
+        inst->occupied = 0;
+        release_lock(5, EXCLUSIVE);
+        return;
     }
-
-    // Add ID to array and sort
-    instructorIdArray[instructorCounter++] = inst->id;
-    qsort(instructorIdArray, instructorCounter, sizeof(int), compareInstructorId);
-
-    // Add to name mapping
-    if (instructorMappingCount < NAME_MAPPING_SIZE) {
-        strncpy(instructorNameIdMapping[instructorMappingCount].firstName, inst->firstName, 50);
-        strncpy(instructorNameIdMapping[instructorMappingCount].lastName, inst->lastName, 50);
-        instructorNameIdMapping[instructorMappingCount].id = inst->id;
-        instructorMappingCount++;
-        qsort(instructorNameIdMapping, instructorMappingCount, sizeof(InstructorNameIdMapping), compareInstructorName);
+    instructorCounter++;
+
+    // Store to file, an instructor that cannot be logged would be lost on
+    // restart. The caller keeps the record and sees it unoccupied.
+    if (!isInit && !storeInstructor(inst)) {
+        printf("Error: The change could not be logged, the instructor was not added.\n");
+        btreeIndexRemove(&instructorIdTree, inst->id);
+        instructorCounter--;
+        unindexInstructor(inst);
+        inst->occupied = 0;
     }
 
-    // Store to file
-    if (!isInit) storeInstructor(inst);
-
     release_lock(5, EXCLUSIVE);
 }
 
@@ -230,43 +491,64 @@ void insertInstructor(Instructor *inst, bool isInit) {
 void deleteInstructor(int id) {
     acquire_lock(5, EXCLUSIVE);
 
-    int index = hash(id);
-    while (instructorHashTable[index] != NULL) {
-        if (instructorHashTable[index]->occupied && instructorHashTable[index]->id == id) {
-            for (int i = 0; i < HASH_TABLE_SIZE * MAX_PHONE_NUMBERS; i++) {
-                if (instructorPhoneNumbers[i].instructorId == id) {
-                    instructorPhoneNumbers[i].id = 0;
-                    instructorPhoneNumbers[i].instructorId = 0;
-                }
-            }
+    Instructor *inst = searchInstructorById(id);
+    if (inst == NULL) {
+        printf("Instructor not found.\n");
+        release_lock(5, EXCLUSIVE);
+        return;
+    }
 
-            instructorHashTable[index]->occupied = 0;
-            printf("\nInstructor %s deleted successfully!\n", instructorHashTable[index]->firstName);
-
-            for (int i = 0; i < instructorMappingCount; i++) {
-                if (instructorNameIdMapping[i].id == id) {
-                    for (int j = i; j < instructorMappingCount - 1; j++) {
-                        instructorNameIdMapping[j] = instructorNameIdMapping[j + 1];
-                    }
-                    instructorMappingCount--;
-                    break;
-                }
-            }
+    // Courses taught by the instructor must be reassigned first. The count
+    // changes under the course lock, and insertCourse holds that while
+    // checking ours, so this wait may be aborted.
+    if (!acquire_lock_abortable(2, SHARED)) {
+        printf("Error: Courses are locked by another user, try again.\n");
+        release_lock(5, EXCLUSIVE);
+        return;
+    }
+    size_t courses = refIndexCount(&coursesByInstructor, (uint64_t)id);
+    release_lock(2, SHARED);
+    if (courses > 0) {
+        printf("Error: Cannot delete instructor - Courses are assigned\n");
+        release_lock(5, EXCLUSIVE);
+        return;
+    }
 
-            int *found = bsearch(&id, instructorIdArray, instructorCounter, sizeof(int), compareInstructorId);
-            if (found != NULL) {
-                memmove(found, found + 1, (--instructorCounter - (found - instructorIdArray)) * sizeof(int));
+    // Phone numbers go first so a replay never sees orphaned numbers
+    for (int i = 0; i < phoneNumberCapacity; i++) {
+        if (instructorPhoneNumbers[i].id != 0 && instructorPhoneNumbers[i].instructorId == id) {
+            if (walLog(&phoneNumberStorage, WAL_DELETE, &instructorPhoneNumbers[i], NULL) == 0) {
+                printf("Error: The change could not be logged, the instructor was not deleted.\n");
+                release_lock(5, EXCLUSIVE);
+                return;
             }
-            release_lock(5, EXCLUSIVE);
-            return;
+            instructorPhoneNumbers[i].id = 0;
+            instructorPhoneNumbers[i].instructorId = 0;
         }
-        index = hash(index + 1);
     }
 
-    printf("Instructor not found.\n");
+    if (walLog(&instructorStorage, WAL_DELETE, inst, NULL) == 0) {
+        printf("Error: The change could not be logged, the instructor was not deleted.\n");
+    } else {
+        printf("\nInstructor %s deleted successfully!\n", inst->firstName);
+        removeInstructor(inst);
+    }
+
     release_lock(5, EXCLUSIVE);
 }
 
+// Remove an instructor from the indexes and free it.
+void removeInstructor(Instructor *inst) {
+    int id = inst->id;
+    unindexInstructor(inst);
+
+    if (btreeIndexRemove(&instructorIdTree, id)) {
+        instructorCounter--;
+    }
+
+    free(inst);
+}
+
 void updateInstructor(int id, char *email) {
     acquire_lock(5, EXCLUSIVE);
 
@@ -280,28 +562,26 @@ void updateInstructor(int id, char *email) {
             return;
         }
 
+        Instructor before = *inst;
         strncpy(inst->email, email, 100);
-        printf("\nEmail updated successfully.\n");
-
-        // Update email in the file
-        FILE *file = fopen("data/Instructors.txt", "r");
-        FILE *temp = fopen("data/Instructors_temp.txt", "w");
-
-        if (file && temp) {
-            int curr_id, departmentId;
-            char firstName[50], lastName[50], curr_email[100];
-            while (fscanf(file, "%d %s %s %s %d\n", &curr_id, firstName, lastName,
-                          curr_email, &departmentId) != EOF) {
-                if (curr_id == id) {
-                    fprintf(temp, "%d %s %s %s %d\n", id, firstName, lastName, email, departmentId);
-                } else {
-                    fprintf(temp, "%d %s %s %s %d\n", curr_id, firstName, lastName, curr_email, departmentId);
-                }
-            }
-            fclose(file);
-            fclose(temp);
-            remove("data/Instructors.txt");
-            rename("data/Instructors_temp.txt", "data/Instructors.txt");
+        inst->email[99] = '\0';
+
+        // Re-key the email index
+        if (!hashIndexInsert(&instructorEmailIndex, hashIndexStringKey(inst->email), (uintptr_t)inst)) {
+            *inst = before;
+            release_lock(5, EXCLUSIVE);
+            return;
+        }
+        hashIndexRemove(&instructorEmailIndex, hashIndexStringKey(before.email), (uintptr_t)inst);
+
+        // Log the change instead of rewriting the page file
+        if (walLog(&instructorStorage, WAL_UPDATE, &before, inst) == 0) {
+            hashIndexInsert(&instructorEmailIndex, hashIndexStringKey(before.email), (uintptr_t)inst);
+            hashIndexRemove(&instructorEmailIndex, hashIndexStringKey(inst->email), (uintptr_t)inst);
+            *inst = before;
+            printf("Error: The change could not be logged, the email was not updated.\n");
+        } else {
+            printf("\nEmail updated successfully.\n");
         }
     } else {
         printf("Instructor not found.\n");
@@ -313,12 +593,6 @@ void updateInstructor(int id, char *email) {
 
 void addInstructorPhoneNumber(int instructorId, char phone[]) {
 
-    Instructor *inst = searchInstructorById(instructorId);
-    if (!inst) {
-        printf("Error: Instructor not found.\n");
-        return;
-    }
-
     if (strlen(phone) == 0 || strlen(phone) > 14) {
         printf("Error: Phone number must be between 1 and 14 characters.\n");
         return;
@@ -332,8 +606,26 @@ void addInstructorPhoneNumber(int instructorId, char phone[]) {
         }
     }
 
+    acquire_lock(5, EXCLUSIVE);
+
+    Instructor *inst = searchInstructorById(instructorId);
+    if (!inst) {
+        printf("Error: Instructor not found.\n");
+        release_lock(5, EXCLUSIVE);
+        return;
+    }
+
+    // Check for unique phone number
+    for (int i = 0; i < phoneNumberCapacity; i++) {
+        if (instructorPhoneNumbers[i].id != 0 && strcmp(instructorPhoneNumbers[i].phone, phone) == 0) {
+            printf("Error: This phone number is already registered.\n");
+            release_lock(5, EXCLUSIVE);
+            return;
+        }
+    }
+
     int count = 0;
-    for (int i = 0; i < HASH_TABLE_SIZE * MAX_PHONE_NUMBERS; i++) {
+    for (int i = 0; i < phoneNumberCapacity; i++) {
         if (instructorPhoneNumbers[i].instructorId == instructorId) {
             count++;
         }
@@ -341,44 +633,63 @@ void addInstructorPhoneNumber(int instructorId, char phone[]) {
 
     if (count >= MAX_PHONE_NUMBERS) {
         printf("Error: Maximum number of phone numbers reached for this instructor.\n");
+        release_lock(5, EXCLUSIVE);
         return;
     }
 
-    for (int i = 0; i < HASH_TABLE_SIZE * MAX_PHONE_NUMBERS; i++) {
-        if (instructorPhoneNumbers[i].id == 0) {
-            instructorPhoneNumbers[i].id = nextPhoneNumberId++;
-            instructorPhoneNumbers[i].instructorId = instructorId;
-            strncpy(instructorPhoneNumbers[i].phone, phone, 15);
-            storeInstructorPhoneNumber(&instructorPhoneNumbers[i]);
-            printf("Phone number added successfully.\n");
-            return;
-        }
+    int slot = findFreePhoneNumberSlot();
+    if (slot < 0) {
+        release_lock(5, EXCLUSIVE);
+        return;
     }
 
-    printf("Error: Phone number storage is full.\n");
+    instructorPhoneNumbers[slot].id = nextPhoneNumberId++;
+    instructorPhoneNumbers[slot].instructorId = instructorId;
+    strncpy(instructorPhoneNumbers[slot].phone, phone, 15);
+    if (!storeInstructorPhoneNumber(&instructorPhoneNumbers[slot])) {
+        printf("Error: The change could not be logged, the phone number was not added.\n");
+        instructorPhoneNumbers[slot].id = 0;
+        instructorPhoneNumbers[slot].instructorId = 0;
+        release_lock(5, EXCLUSIVE);
+        return;
+    }
+    printf("Phone number added successfully.\n");
+
+    release_lock(5, EXCLUSIVE);
 }
 
 // Remove phone number from an instructor
 void removeInstructorPhoneNumber(int phoneNumberId) {
+    acquire_lock(5, EXCLUSIVE);
 
-    for (int i = 0; i < HASH_TABLE_SIZE * MAX_PHONE_NUMBERS; i++) {
+    for (int i = 0; i < phoneNumberCapacity; i++) {
         if (instructorPhoneNumbers[i].id == phoneNumberId) {
+            if (walLog(&phoneNumberStorage, WAL_DELETE, &instructorPhoneNumbers[i], NULL) == 0) {
+                printf("Error: The change could not be logged, the phone number was not removed.\n");
+                release_lock(5, EXCLUSIVE);
+                return;
+            }
             instructorPhoneNumbers[i].id = 0;
             instructorPhoneNumbers[i].instructorId = 0;
             printf("Phone number removed successfully.\n");
+            release_lock(5, EXCLUSIVE);
             return;
         }
     }
 
     printf("Error: Phone number not found.\n");
+
+    release_lock(5, EXCLUSIVE);
 }
 
 // Show all phone numbers of an instructor
 void showInstructorPhoneNumbers(int instructorId) {
+    acquire_lock(5, SHARED);
 
     Instructor *inst = searchInstructorById(instructorId);
     if (!inst) {
         printf("Error: Instructor not found.\n");
+        release_lock(5, SHARED);
         return;
     }
 
@@ -386,7 +697,7 @@ void showInstructorPhoneNumbers(int instructorId) {
     printf("Phone Numbers:\n");
 
     bool found = false;
-    for (int i = 0; i < HASH_TABLE_SIZE * MAX_PHONE_NUMBERS; i++) {
+    for (int i = 0; i < phoneNumberCapacity; i++) {
         if (instructorPhoneNumbers[i].instructorId == instructorId) {
             printf("ID: %d, Phone: %s\n", 
                    instructorPhoneNumbers[i].id, 
@@ -399,43 +710,20 @@ void showInstructorPhoneNumbers(int instructorId) {
         printf("No phone numbers found.\n");
     }
 
+    release_lock(5, SHARED);
 }
 
-void *printInstructor(void *arg) {
-    acquire_lock(5, SHARED);
-
-    InstructorThreadArg *threadArg = (InstructorThreadArg *)arg;
-    Instructor *instructor = threadArg->instructor;
-
-    printf("Instructor ID: %d Name: %s %s Email: %s Department ID: %d \n",
-           instructor->id, instructor->firstName, instructor->lastName,
-           instructor->email, instructor->departmentId);
-
-    release_lock(5, SHARED);
-    return NULL;
+static int formatInstructorRow(char *buffer, size_t size, const void *row) {
+    const Instructor *instructor = (const Instructor *)row;
+    return snprintf(buffer, size, "Instructor ID: %d Name: %s %s Email: %s Department ID: %d \n",
+                    instructor->id, instructor->firstName, instructor->lastName,
+                    instructor->email, instructor->departmentId);
 }
 
 void showAllInstructors() {
     acquire_lock(5, SHARED);
-
     printf("\nThere are currently %d instructor(s) in the database.\n", instructorCounter);
-
-    pthread_t threads[instructorCounter];
-    InstructorThreadArg args[instructorCounter];
-    int index = 0;
-
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (instructorHashTable[i] != NULL && instructorHashTable[i]->occupied) {
-            args[index].instructor = instructorHashTable[i];
-            pthread_create(&threads[index], NULL, printInstructor, &args[index]);
-            index++;
-        }
-    }
-
-    for (int i = 0; i < index; i++) {
-        pthread_join(threads[i], NULL);
-    }
-
+    printRows(&instructorIdTree, formatInstructorRow);
     release_lock(5, SHARED);
 }
 
@@ -456,42 +744,29 @@ void showInstructor(Instructor *inst)
 
 Instructor *searchInstructorById(int id) {
 
-    int index = hash(id);
-    while (instructorHashTable[index] != NULL) {
-        if (instructorHashTable[index]->occupied && instructorHashTable[index]->id == id) {
-            return instructorHashTable[index];
-        }
-        index = hash(index + 1);
+    uintptr_t value;
+    if (hashIndexFind(&instructorIndex, (uint64_t)id, &value)) {
+        return (Instructor *)value;
     }
-
     return NULL;
 }
 
 // Search instructor by name
 Instructor *searchInstructorByName(char firstName[], char lastName[]) {
-
-    for (int i = 0; i < instructorMappingCount; i++) {
-        if (strcmp(instructorNameIdMapping[i].firstName, firstName) == 0 &&
-            strcmp(instructorNameIdMapping[i].lastName, lastName) == 0) {
-            release_lock(5, SHARED);
-            return searchInstructorById(instructorNameIdMapping[i].id);
-        }
+    InstructorNameQuery query = { firstName, lastName };
+    uintptr_t value;
+    if (hashIndexFindMatch(&instructorNameIndex, instructorNameKey(firstName, lastName), instructorNameMatches, &query, &value)) {
+        return (Instructor *)value;
     }
-
     return NULL;
 }
 
 // Search instructor by email
 Instructor *searchInstructorByEmail(char email[]) {
-
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (instructorHashTable[i] != NULL && instructorHashTable[i]->occupied &&
-            strcmp(instructorHashTable[i]->email, email) == 0) {
-            release_lock(5, SHARED);
-            return instructorHashTable[i];
-        }
+    uintptr_t value;
+    if (hashIndexFindMatch(&instructorEmailIndex, hashIndexStringKey(email), instructorEmailMatches, email, &value)) {
+        return (Instructor *)value;
     }
-
     return NULL;
 }
 
@@ -500,14 +775,11 @@ void searchInstructorsByDepartment(int departmentId)
     printf("\nInstructors in Department %d:\n", departmentId);
     bool found = false;
     
-    for (int i = 0; i < HASH_TABLE_SIZE; i++)
+    const RefList *list = refIndexFind(&instructorsByDepartment, (uint64_t)departmentId);
+    for (size_t i = 0; list != NULL && i < list->count; i++)
     {
-        if (instructorHashTable[i] != NULL && instructorHashTable[i]->occupied == 1 &&
-            instructorHashTable[i]->departmentId == departmentId)
-        {
-            showInstructor(instructorHashTable[i]);
-            found = true;
-        }
+        showInstructor((Instructor *)list->handles[i]);
+        found = true;
     }
     
     if (!found)
@@ -516,6 +788,38 @@ void searchInstructorsByDepartment(int departmentId)
     }
 }
 
+// Instructors whose "first last" name starts with prefix, ignoring case, in name order
+int searchInstructorsByNamePrefix(char prefix[], Instructor *results[], int limit)
+{
+    if (limit <= 0) return 0;
+
+    uintptr_t handles[limit];
+    size_t found = prefixIndexSearch(&instructorNamePrefixIndex, prefix, handles, (size_t)limit);
+    for (size_t i = 0; i < found; i++)
+    {
+        results[i] = (Instructor *)handles[i];
+    }
+    return (int)found;
+}
+
+void showInstructorNameSuggestions(char prefix[])
+{
+    Instructor *results[NAME_SUGGESTION_LIMIT];
+
+    acquire_lock(5, SHARED);
+    int found = searchInstructorsByNamePrefix(prefix, results, NAME_SUGGESTION_LIMIT);
+    printf("\nInstructors matching \"%s\":\n", prefix);
+    for (int i = 0; i < found; i++)
+    {
+        printf("ID: %d Name: %s %s\n", results[i]->id, results[i]->firstName, results[i]->lastName);
+    }
+    if (found == 0)
+    {
+        printf("No instructors found.\n");
+    }
+    release_lock(5, SHARED);
+}
+
 // Menu Operations
 
 Instructor *selectInstructorMenu()
@@ -631,24 +935,8 @@ void insertInstructorMenu()
                 printf("Enter phone number: ");
                 scanf("%s", phone);
                 getchar();
-                
-                // Check for unique phone number
-                bool isUnique = true;
-                for (int i = 0; i < HASH_TABLE_SIZE * MAX_PHONE_NUMBERS; i++)
-                {
-                    if (instructorPhoneNumbers[i].id != 0 && 
-                        strcmp(instructorPhoneNumbers[i].phone, phone) == 0)
-                    {
-                        printf("Error: This phone number is already registered.\n");
-                        isUnique = false;
-                        break;
-                    }
-                }
-                
-                if (isUnique)
-                {
-                    addInstructorPhoneNumber(instructor->id, phone);
-                }
+
+                addInstructorPhoneNumber(instructor->id, phone);
             }
         } while (tolower(choice) == 'y');
     }
@@ -677,24 +965,8 @@ void manageInstructorPhoneNumbersMenu(int instructorId)
             printf("Enter phone number: ");
             scanf("%s", phone);
             getchar();
-            
-            // Check for unique phone number
-            bool isUnique = true;
-            for (int i = 0; i < HASH_TABLE_SIZE * MAX_PHONE_NUMBERS; i++)
-            {
-                if (instructorPhoneNumbers[i].id != 0 && 
-                    strcmp(instructorPhoneNumbers[i].phone, phone) == 0)
-                {
-                    printf("Error: This phone number is already registered.\n");
-                    isUnique = false;
-                    break;
-                }
-            }
-            
-            if (isUnique)
-            {
-                addInstructorPhoneNumber(instructorId, phone);
-            }
+
+            addInstructorPhoneNumber(instructorId, phone);
             break;
         case 2:
             showInstructorPhoneNumbers(instructorId);
@@ -795,6 +1067,7 @@ void instructorMenu()
         printf("4- Update instructor\n");
         printf("5- Delete instructor\n");
         printf("6- View instructor phone numbers\n");
+        printf("7- Find instructors by name prefix\n");
         printf("0- Return to main menu\n");
         printf("Enter your choice: ");
         scanf("%d", &choice);
@@ -820,6 +1093,15 @@ void instructorMenu()
         case 6:
             viewInstructorPhoneNumbersMenu();
             break;
+        case 7:
+        {
+            char prefix[100];
+            printf("Enter the start of the name: ");
+            fgets(prefix, sizeof(prefix), stdin);
+            prefix[strcspn(prefix, "\n")] = 0;
+            showInstructorNameSuggestions(prefix);
+            break;
+        }
         case 0:
             printf("\nReturning to main menu...\n");
             break;
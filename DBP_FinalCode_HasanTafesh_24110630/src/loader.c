@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "../include/loader.h"
+#include "../include/department.h"
+#include "../include/instructor.h"
+#include "../include/student.h"
+#include "../include/course.h"
+#include "../include/enrollment.h"
+#include "../include/storage.h"
+#include "../include/thread_pool.h"
+
+typedef struct {
+    const char *name;
+    void (*init)();
+    pthread_t thread;
+    bool started;
+} TableLoad;
+
+static void *runTableLoad(void *arg) {
+    TableLoad *load = (TableLoad *)arg;
+    load->init();
+    return NULL;
+}
+
+void loadAllTables() {
+    TableLoad loads[] = {
+        { .name = "Departments", .init = initDepartments, .started = false },
+        { .name = "Instructors", .init = initInstructors, .started = false },
+        { .name = "Students", .init = initStudents, .started = false },
+        { .name = "Courses", .init = initCourses, .started = false },
+        { .name = "Enrollments", .init = initEnrollments, .started = false },
+    };
+    int loadCount = sizeof(loads) / sizeof(loads[0]);
+
+    ThreadPool pool;
+    bool pooled = threadPoolInit(&pool, threadPoolDefaultSize());
+    storageSetThreadPool(pooled ? &pool : NULL);
+
+    // A table whose thread cannot be started is loaded right here
+    for (int i = 0; i < loadCount; i++) {
+        loads[i].started = pthread_create(&loads[i].thread, NULL, runTableLoad, &loads[i]) == 0;
+        if (!loads[i].started) {
+            loads[i].init();
+        }
+    }
+    for (int i = 0; i < loadCount; i++) {
+        if (loads[i].started) {
+            pthread_join(loads[i].thread, NULL);
+        }
+        printf("Initializing %s\n", loads[i].name);
+    }
+
+    storageSetThreadPool(NULL);
+    if (pooled) {
+        threadPoolFree(&pool);
+    }
+
+    // Students are dropped before enrollments are checked against them
+    checkStudentReferences();
+    checkInstructorReferences();
+    checkCourseReferences();
+    checkEnrollmentReferences();
+}
@@ -2,67 +2,633 @@
 #include "lock_management.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
 #include <unistd.h>
 
 #define MAX_TABLES 5
+#define LOCK_MODES 6
 
-typedef struct {
-    int table_id;
+// Row lock buckets share this many mutexes, so the deadlock detector can
+// hold all of them at once
+#define LOCK_PARTITIONS 16
+
+typedef struct LockOwner LockOwner;
+
+// A thread waiting for a lock. It lives on the waiter's stack and has its
+// own condition variable, so a release wakes exactly the requests it grants.
+typedef struct LockRequest {
     LockType lock_type;
-    int lock_count; // this is count of shared locks if lock_type == SHARED
-    pthread_mutex_t lock_mutex;
-    pthread_cond_t lock_cond;
+    LockType held_lock; // mode given up when granted, NONE unless upgrading
+    bool granted;
+    bool abortable; // the caller copes with not getting the lock
+    bool aborted; // chosen as a deadlock victim
+    bool stuck; // in a deadlock with no abortable request, reported once
+    unsigned long wait_ticket; // later waits have higher tickets
+    LockOwner *owner;
+    pthread_cond_t request_cond;
+    struct LockRequest *next;
+} LockRequest;
+
+// Waiting requests are granted in arrival order, upgrades first. A new
+// request only skips the queue when nobody is waiting, so a writer waits for
+// the holders ahead of it and never for readers that came later.
+typedef struct Lock {
+    int table_id;
+    int row_id;
+    int held[LOCK_MODES]; // holders per lock type
+    LockRequest *queue_head;
+    LockRequest *queue_tail;
+    struct Lock *next; // next row lock in the same bucket
 } Lock;
 
+// A bucket's partition mutex guards every row lock chained in it
+typedef struct {
+    pthread_mutex_t *lock_mutex;
+    Lock *locks;
+} LockBucket;
+
+typedef struct {
+    Lock *lock;
+    LockType lock_type;
+} HeldLock;
+
+// Every thread that has used a lock, for the waits-for graph. The fields
+// are changed by the owning thread under the mutex of the lock involved, so
+// the detector reads them consistently while it holds every lock mutex.
+struct LockOwner {
+    int owner_id;
+    LockRequest *waiting; // request the thread is blocked on
+    Lock *waiting_lock;
+    HeldLock *held;
+    int held_count;
+    int held_capacity;
+    LockOwner *next;
+};
+
 Lock lock_table[MAX_TABLES];
+static pthread_mutex_t table_mutexes[MAX_TABLES];
+static LockBucket row_buckets[LOCK_BUCKETS];
+static pthread_mutex_t partition_mutexes[LOCK_PARTITIONS];
+static int lock_timeout_ms = LOCK_DEFAULT_TIMEOUT_MS;
+
+// Taken before any lock mutex, never while holding one
+static pthread_mutex_t owners_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t owner_key;
+static LockOwner *owners = NULL;
+static int owner_count = 0;
+static int next_owner_id = 0;
+
+// Deadlock detector
+static pthread_t detector_thread;
+static bool detector_running = false;
+static pthread_mutex_t detector_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t detector_cond = PTHREAD_COND_INITIALIZER;
+
+// Statistics, waits_mutex is taken last and nothing is locked under it
+static pthread_mutex_t waits_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int waiting_requests = 0;
+static unsigned long wait_tickets = 0;
+static unsigned long lock_waits = 0;
+static unsigned long lock_timeouts = 0;
+static unsigned long deadlock_checks = 0;
+static unsigned long deadlocks_found = 0;
+static unsigned long deadlock_victims = 0;
+static unsigned long deadlocks_stuck = 0;
+
+// compatible[requested][held]
+static const bool compatible[LOCK_MODES][LOCK_MODES] = {
+    [SHARED]                     = { [SHARED] = true, [INTENTION_SHARED] = true },
+    [EXCLUSIVE]                  = { false },
+    [INTENTION_SHARED]           = { [SHARED] = true, [INTENTION_SHARED] = true, [INTENTION_EXCLUSIVE] = true,
+                                     [SHARED_INTENTION_EXCLUSIVE] = true },
+    [INTENTION_EXCLUSIVE]        = { [INTENTION_SHARED] = true, [INTENTION_EXCLUSIVE] = true },
+    [SHARED_INTENTION_EXCLUSIVE] = { [INTENTION_SHARED] = true },
+};
+
+static void forget_owner(void *arg) {
+    LockOwner *owner = (LockOwner *)arg;
+    pthread_mutex_lock(&owners_mutex);
+    LockOwner **link = &owners;
+    while (*link != owner) link = &(*link)->next;
+    *link = owner->next;
+    owner_count--;
+    pthread_mutex_unlock(&owners_mutex);
+    free(owner->held);
+    free(owner);
+}
+
+static void init_lock(Lock *lock, int table_id, int row_id) {
+    lock->table_id = table_id;
+    lock->row_id = row_id;
+    for (int mode = 0; mode < LOCK_MODES; mode++) {
+        lock->held[mode] = 0;
+    }
+    lock->queue_head = NULL;
+    lock->queue_tail = NULL;
+    lock->next = NULL;
+}
 
 void initialize_lock_table() {
     for (int i = 0; i < MAX_TABLES; i++) {
-        lock_table[i].table_id = i + 1;
-        lock_table[i].lock_type = NONE;
-        lock_table[i].lock_count = 0;
-        pthread_mutex_init(&lock_table[i].lock_mutex, NULL);
-        pthread_cond_init(&lock_table[i].lock_cond, NULL);
+        init_lock(&lock_table[i], i + 1, 0);
+        pthread_mutex_init(&table_mutexes[i], NULL);
+    }
+    for (int i = 0; i < LOCK_PARTITIONS; i++) {
+        pthread_mutex_init(&partition_mutexes[i], NULL);
+    }
+    for (int i = 0; i < LOCK_BUCKETS; i++) {
+        row_buckets[i].lock_mutex = &partition_mutexes[i % LOCK_PARTITIONS];
+        row_buckets[i].locks = NULL;
     }
+    pthread_key_create(&owner_key, forget_owner);
 }
 
-void acquire_lock(int table_id, LockType requested_lock) {
-    Lock *lock = &lock_table[table_id - 1];
+void set_lock_timeout(int milliseconds) {
+    lock_timeout_ms = milliseconds > 0 ? milliseconds : 0;
+}
 
-    pthread_mutex_lock(&lock->lock_mutex);
+// The calling thread's owner record, registered on its first lock
+static LockOwner *current_owner() {
+    LockOwner *owner = pthread_getspecific(owner_key);
+    if (owner != NULL) return owner;
 
-    while (1) {
-        if (requested_lock == SHARED) {
-            if (lock->lock_type == NONE || lock->lock_type == SHARED) {
-                lock->lock_type = SHARED;
-                lock->lock_count++;
-                break;
-            }
-        } else if (requested_lock == EXCLUSIVE) {
-            if (lock->lock_type == NONE) {
-                lock->lock_type = EXCLUSIVE;
-                break;
+    owner = calloc(1, sizeof(LockOwner));
+    if (owner == NULL) {
+        printf("Error: Memory allocation failed for a lock owner.\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_lock(&owners_mutex);
+    owner->owner_id = ++next_owner_id;
+    owner->next = owners;
+    owners = owner;
+    owner_count++;
+    pthread_mutex_unlock(&owners_mutex);
+    pthread_setspecific(owner_key, owner);
+    return owner;
+}
+
+// Held lock bookkeeping, under the lock's mutex. A lock the list has no room
+// for is still held, the detector just cannot see it.
+static void remember_lock(LockOwner *owner, Lock *lock, LockType lock_type, LockType held_lock) {
+    if (held_lock != NONE) {
+        for (int i = 0; i < owner->held_count; i++) {
+            if (owner->held[i].lock == lock && owner->held[i].lock_type == held_lock) {
+                owner->held[i].lock_type = lock_type;
+                return;
             }
         }
-        pthread_cond_wait(&lock->lock_cond, &lock->lock_mutex);
     }
+    if (owner->held_count == owner->held_capacity) {
+        int capacity = owner->held_capacity > 0 ? owner->held_capacity * 2 : 8;
+        HeldLock *grown = realloc(owner->held, capacity * sizeof(HeldLock));
+        if (grown == NULL) return;
+        owner->held = grown;
+        owner->held_capacity = capacity;
+    }
+    owner->held[owner->held_count].lock = lock;
+    owner->held[owner->held_count].lock_type = lock_type;
+    owner->held_count++;
+}
+
+static void forget_lock(LockOwner *owner, Lock *lock, LockType lock_type) {
+    for (int i = owner->held_count - 1; i >= 0; i--) {
+        if (owner->held[i].lock == lock && owner->held[i].lock_type == lock_type) {
+            owner->held[i] = owner->held[--owner->held_count];
+            return;
+        }
+    }
+}
+
+// An upgrade does not conflict with the lock it is converting
+static bool can_grant(const Lock *lock, LockType requested_lock, LockType held_lock) {
+    for (int mode = SHARED; mode < LOCK_MODES; mode++) {
+        int holders = lock->held[mode] - (mode == (int)held_lock ? 1 : 0);
+        if (holders > 0 && !compatible[requested_lock][mode]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void grant(Lock *lock, LockType lock_type, LockType held_lock) {
+    if (held_lock != NONE) lock->held[held_lock]--;
+    lock->held[lock_type]++;
+}
+
+// Grants queued requests from the front until one has to keep waiting
+static void grant_waiting(Lock *lock) {
+    while (lock->queue_head != NULL &&
+           can_grant(lock, lock->queue_head->lock_type, lock->queue_head->held_lock)) {
+        LockRequest *request = lock->queue_head;
+        lock->queue_head = request->next;
+        if (lock->queue_head == NULL) lock->queue_tail = NULL;
+        grant(lock, request->lock_type, request->held_lock);
+        request->granted = true;
+        pthread_cond_signal(&request->request_cond);
+    }
+}
+
+// Upgrades go behind the upgrades already queued, everything else at the end
+static void enqueue(Lock *lock, LockRequest *request) {
+    LockRequest *before = NULL;
+    if (request->held_lock != NONE) {
+        for (LockRequest *queued = lock->queue_head; queued != NULL && queued->held_lock != NONE;
+             queued = queued->next) {
+            before = queued;
+        }
+    } else {
+        before = lock->queue_tail;
+    }
+    request->next = before != NULL ? before->next : lock->queue_head;
+    if (before != NULL) before->next = request;
+    else lock->queue_head = request;
+    if (request->next == NULL) lock->queue_tail = request;
+}
+
+static void dequeue(Lock *lock, LockRequest *request) {
+    LockRequest **link = &lock->queue_head;
+    LockRequest *last = NULL;
+    while (*link != request) {
+        last = *link;
+        link = &(*link)->next;
+    }
+    *link = request->next;
+    if (lock->queue_tail == request) lock->queue_tail = last;
+}
+
+// Takes lock_type on a lock whose mutex is held, waiting until the deadline
+// when there is one. Returns false when the request timed out or was
+// aborted by the deadlock detector.
+static bool lock_mode(LockOwner *owner, Lock *lock, pthread_mutex_t *mutex, LockType requested_lock,
+                      LockType held_lock, const struct timespec *deadline, bool abortable) {
+    bool queue_free = lock->queue_head == NULL ||
+                      (held_lock != NONE && lock->queue_head->held_lock == NONE);
+    if (queue_free && can_grant(lock, requested_lock, held_lock)) {
+        grant(lock, requested_lock, held_lock);
+        remember_lock(owner, lock, requested_lock, held_lock);
+        return true;
+    }
+
+    LockRequest request = { .lock_type = requested_lock, .held_lock = held_lock, .abortable = abortable, .owner = owner };
+    pthread_cond_init(&request.request_cond, NULL);
+    enqueue(lock, &request);
+    owner->waiting = &request;
+    owner->waiting_lock = lock;
+
+    pthread_mutex_lock(&waits_mutex);
+    request.wait_ticket = ++wait_tickets;
+    waiting_requests++;
+    lock_waits++;
+    pthread_mutex_unlock(&waits_mutex);
+
+    int result = 0;
+    while (!request.granted && !request.aborted && result != ETIMEDOUT) {
+        if (deadline != NULL) {
+            result = pthread_cond_timedwait(&request.request_cond, mutex, deadline);
+        } else {
+            pthread_cond_wait(&request.request_cond, mutex);
+        }
+    }
+
+    pthread_mutex_lock(&waits_mutex);
+    waiting_requests--;
+    if (!request.granted && !request.aborted) lock_timeouts++;
+    pthread_mutex_unlock(&waits_mutex);
+
+    owner->waiting = NULL;
+    owner->waiting_lock = NULL;
+    if (request.granted) {
+        // Granted before the abort was seen, keep it
+        remember_lock(owner, lock, requested_lock, held_lock);
+    } else {
+        // Leaving may let the requests behind this one through
+        dequeue(lock, &request);
+        grant_waiting(lock);
+    }
+    pthread_cond_destroy(&request.request_cond);
+    return request.granted;
+}
+
+static void unlock_mode(LockOwner *owner, Lock *lock, LockType lock_type) {
+    lock->held[lock_type]--;
+    forget_lock(owner, lock, lock_type);
+    grant_waiting(lock);
+}
+
+static bool lock_unused(const Lock *lock) {
+    if (lock->queue_head != NULL) return false;
+    for (int mode = SHARED; mode < LOCK_MODES; mode++) {
+        if (lock->held[mode] > 0) return false;
+    }
+    return true;
+}
+
+static LockBucket *row_bucket(int table_id, int row_id) {
+    uint64_t key = ((uint64_t)(uint32_t)table_id << 32) | (uint32_t)row_id;
+    key *= 0x9E3779B97F4A7C15ull;
+    return &row_buckets[(key >> 32) % LOCK_BUCKETS];
+}
+
+// The row's lock, created when asked to. The bucket mutex is held.
+static Lock *find_row_lock(LockBucket *bucket, int table_id, int row_id, bool create) {
+    for (Lock *lock = bucket->locks; lock != NULL; lock = lock->next) {
+        if (lock->table_id == table_id && lock->row_id == row_id) return lock;
+    }
+    if (!create) return NULL;
+
+    Lock *lock = malloc(sizeof(Lock));
+    if (lock == NULL) {
+        printf("Error: Memory allocation failed for a row lock.\n");
+        return NULL;
+    }
+    init_lock(lock, table_id, row_id);
+    lock->next = bucket->locks;
+    bucket->locks = lock;
+    return lock;
+}
+
+static void free_row_lock_if_unused(LockBucket *bucket, Lock *lock) {
+    if (!lock_unused(lock)) return;
+    Lock **link = &bucket->locks;
+    while (*link != lock) link = &(*link)->next;
+    *link = lock->next;
+    free(lock);
+}
+
+static bool lock_table_mode(int table_id, LockType requested_lock, LockType held_lock,
+                            const struct timespec *deadline, bool abortable) {
+    LockOwner *owner = current_owner();
+    pthread_mutex_lock(&table_mutexes[table_id - 1]);
+    bool granted = lock_mode(owner, &lock_table[table_id - 1], &table_mutexes[table_id - 1], requested_lock,
+                             held_lock, deadline, abortable);
+    pthread_mutex_unlock(&table_mutexes[table_id - 1]);
+    return granted;
+}
+
+void acquire_lock(int table_id, LockType requested_lock) {
+    if (requested_lock == NONE) return;
+    lock_table_mode(table_id, requested_lock, NONE, NULL, false);
+}
 
-    pthread_mutex_unlock(&lock->lock_mutex);
+bool acquire_lock_abortable(int table_id, LockType requested_lock) {
+    if (requested_lock == NONE) return true;
+    return lock_table_mode(table_id, requested_lock, NONE, NULL, true);
 }
 
 void release_lock(int table_id, LockType lock_type) {
-    Lock *lock = &lock_table[table_id - 1];
+    if (lock_type == NONE) return;
+    LockOwner *owner = current_owner();
+    pthread_mutex_lock(&table_mutexes[table_id - 1]);
+    unlock_mode(owner, &lock_table[table_id - 1], lock_type);
+    pthread_mutex_unlock(&table_mutexes[table_id - 1]);
+}
+
+bool upgrade_lock(int table_id, LockType held_lock, LockType lock_type) {
+    return lock_table_mode(table_id, lock_type, held_lock, NULL, true);
+}
+
+bool acquire_row_lock(int table_id, int row_id, LockType requested_lock) {
+    LockType intention = requested_lock == SHARED ? INTENTION_SHARED : INTENTION_EXCLUSIVE;
+    struct timespec deadline;
+    const struct timespec *until = NULL;
+    if (lock_timeout_ms > 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += lock_timeout_ms / 1000;
+        deadline.tv_nsec += (long)(lock_timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        until = &deadline;
+    }
+
+    if (!lock_table_mode(table_id, intention, NONE, until, true)) {
+        return false;
+    }
+
+    LockOwner *owner = current_owner();
+    LockBucket *bucket = row_bucket(table_id, row_id);
+    pthread_mutex_lock(bucket->lock_mutex);
+    Lock *lock = find_row_lock(bucket, table_id, row_id, true);
+    bool granted = lock != NULL && lock_mode(owner, lock, bucket->lock_mutex, requested_lock, NONE, until, true);
+    if (lock != NULL && !granted) {
+        free_row_lock_if_unused(bucket, lock);
+    }
+    pthread_mutex_unlock(bucket->lock_mutex);
+
+    if (!granted) {
+        release_lock(table_id, intention);
+    }
+    return granted;
+}
+
+void release_row_lock(int table_id, int row_id, LockType lock_type) {
+    LockOwner *owner = current_owner();
+    LockBucket *bucket = row_bucket(table_id, row_id);
+    pthread_mutex_lock(bucket->lock_mutex);
+    Lock *lock = find_row_lock(bucket, table_id, row_id, false);
+    if (lock != NULL) {
+        unlock_mode(owner, lock, lock_type);
+        free_row_lock_if_unused(bucket, lock);
+    }
+    pthread_mutex_unlock(bucket->lock_mutex);
+
+    release_lock(table_id, lock_type == SHARED ? INTENTION_SHARED : INTENTION_EXCLUSIVE);
+}
+
+// Deadlock detection. The detector holds owners_mutex and every lock mutex
+// while it looks, so no lock changes hands in between.
+
+static bool is_blocked(const LockOwner *owner) {
+    const LockRequest *request = owner->waiting;
+    return request != NULL && !request->granted && !request->aborted && !request->stuck;
+}
+
+// Whether a blocked waiter has to wait for holder: holder holds a
+// conflicting mode on the lock, or is queued ahead of the waiter
+static bool waits_for(const LockOwner *waiter, const LockOwner *holder) {
+    const Lock *lock = waiter->waiting_lock;
+    const LockRequest *request = waiter->waiting;
+    bool skipped_upgrade = false;
+
+    for (int i = 0; i < holder->held_count; i++) {
+        if (holder->held[i].lock != lock) continue;
+        if (holder == waiter && !skipped_upgrade && holder->held[i].lock_type == request->held_lock) {
+            skipped_upgrade = true;
+            continue;
+        }
+        if (!compatible[request->lock_type][holder->held[i].lock_type]) return true;
+    }
+    for (const LockRequest *queued = lock->queue_head; queued != NULL && queued != request;
+         queued = queued->next) {
+        if (queued->owner == holder) return true;
+    }
+    return false;
+}
+
+// Depth-first search from node, returns the node a back edge leads to and
+// leaves the path in parent[], or -1 when there is no cycle below node
+static int find_cycle(LockOwner **nodes, int count, int node, char *color, int *parent) {
+    color[node] = 1;
+    for (int next = 0; next < count; next++) {
+        // A running thread waits for nobody, so it closes no cycle
+        if (color[next] == 2 || !is_blocked(nodes[next])) continue;
+        if (!waits_for(nodes[node], nodes[next])) continue;
+        if (color[next] == 1) {
+            parent[next] = node;
+            return next;
+        }
+        if (color[next] == 0) {
+            parent[next] = node;
+            int found = find_cycle(nodes, count, next, color, parent);
+            if (found >= 0) return found;
+        }
+    }
+    color[node] = 2;
+    return -1;
+}
+
+static void lock_all_mutexes() {
+    for (int i = 0; i < MAX_TABLES; i++) pthread_mutex_lock(&table_mutexes[i]);
+    for (int i = 0; i < LOCK_PARTITIONS; i++) pthread_mutex_lock(&partition_mutexes[i]);
+}
 
-    pthread_mutex_lock(&lock->lock_mutex);
-    if (lock_type == SHARED) {
-        lock->lock_count--;
-        if (lock->lock_count == 0) {
-            lock->lock_type = NONE;
+static void unlock_all_mutexes() {
+    for (int i = LOCK_PARTITIONS - 1; i >= 0; i--) pthread_mutex_unlock(&partition_mutexes[i]);
+    for (int i = MAX_TABLES - 1; i >= 0; i--) pthread_mutex_unlock(&table_mutexes[i]);
+}
+
+// Breaks every deadlock among the waiting threads, one victim per cycle
+static void detect_deadlocks() {
+    pthread_mutex_lock(&waits_mutex);
+    bool anyone_waiting = waiting_requests > 0;
+    pthread_mutex_unlock(&waits_mutex);
+    if (!anyone_waiting) return;
+
+    pthread_mutex_lock(&owners_mutex);
+    lock_all_mutexes();
+
+    LockOwner **nodes = malloc(owner_count * sizeof(LockOwner *));
+    char *color = malloc(owner_count);
+    int *parent = malloc(owner_count * sizeof(int));
+    int count = 0;
+    for (LockOwner *owner = owners; owner != NULL && nodes != NULL; owner = owner->next) {
+        nodes[count++] = owner;
+    }
+
+    unsigned long found = 0, victims = 0, stuck = 0;
+    bool searching = nodes != NULL && color != NULL && parent != NULL;
+    while (searching) {
+        searching = false;
+        for (int i = 0; i < count; i++) color[i] = 0;
+        for (int start = 0; start < count && !searching; start++) {
+            if (color[start] != 0 || !is_blocked(nodes[start])) continue;
+            int cycle = find_cycle(nodes, count, start, color, parent);
+            if (cycle < 0) continue;
+
+            // Walk the cycle back from the node the back edge reached
+            found++;
+            LockOwner *victim = NULL;
+            int node = cycle;
+            do {
+                LockOwner *owner = nodes[node];
+                if (owner->waiting->abortable &&
+                    (victim == NULL || owner->held_count < victim->held_count ||
+                     (owner->held_count == victim->held_count &&
+                      owner->waiting->wait_ticket > victim->waiting->wait_ticket))) {
+                    victim = owner;
+                }
+                node = parent[node];
+            } while (node != cycle);
+
+            if (victim != NULL) {
+                // The victim leaves the queue itself once it wakes up, the
+                // lock may be freed as soon as it has
+                victim->waiting->aborted = true;
+                pthread_cond_signal(&victim->waiting->request_cond);
+                victims++;
+            } else {
+                // Every wait made while holding a lock is abortable, so
+                // this takes an acquire_lock nested in another lock. Leave
+                // the cycle out of later searches so it is counted once.
+                node = cycle;
+                do {
+                    nodes[node]->waiting->stuck = true;
+                    node = parent[node];
+                } while (node != cycle);
+                stuck++;
+            }
+            searching = true;
         }
-    } else if (lock_type == EXCLUSIVE) {
-        lock->lock_type = NONE;
     }
 
-    pthread_cond_broadcast(&lock->lock_cond);
-    pthread_mutex_unlock(&lock->lock_mutex);
-}
\ No newline at end of file
+    unlock_all_mutexes();
+    pthread_mutex_unlock(&owners_mutex);
+    free(nodes);
+    free(color);
+    free(parent);
+
+    pthread_mutex_lock(&waits_mutex);
+    deadlock_checks++;
+    deadlocks_found += found;
+    deadlock_victims += victims;
+    deadlocks_stuck += stuck;
+    pthread_mutex_unlock(&waits_mutex);
+
+    if (stuck > 0) {
+        printf("Warning: %lu deadlock(s) with no abortable lock request.\n", stuck);
+    }
+}
+
+static void *deadlock_detector(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&detector_mutex);
+    while (detector_running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += DEADLOCK_CHECK_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&detector_cond, &detector_mutex, &deadline);
+        if (!detector_running) break;
+
+        pthread_mutex_unlock(&detector_mutex);
+        detect_deadlocks();
+        pthread_mutex_lock(&detector_mutex);
+    }
+    pthread_mutex_unlock(&detector_mutex);
+    return NULL;
+}
+
+void start_deadlock_detector() {
+    detector_running = true;
+    if (pthread_create(&detector_thread, NULL, deadlock_detector, NULL) != 0) {
+        printf("Error: Could not start the deadlock detector.\n");
+        detector_running = false;
+    }
+}
+
+void stop_deadlock_detector() {
+    pthread_mutex_lock(&detector_mutex);
+    bool wasRunning = detector_running;
+    detector_running = false;
+    pthread_cond_signal(&detector_cond);
+    pthread_mutex_unlock(&detector_mutex);
+
+    if (wasRunning) {
+        pthread_join(detector_thread, NULL);
+    }
+}
+
+void show_lock_statistics() {
+    pthread_mutex_lock(&waits_mutex);
+    printf("\nLock waits: %lu\n", lock_waits);
+    printf("Lock timeouts: %lu\n", lock_timeouts);
+    printf("Deadlock checks: %lu\n", deadlock_checks);
+    printf("Deadlocks found: %lu\n", deadlocks_found);
+    printf("Deadlock victims: %lu\n", deadlock_victims);
+    printf("Deadlocks without a victim: %lu\n", deadlocks_stuck);
+    pthread_mutex_unlock(&waits_mutex);
+}
@@ -10,6 +10,10 @@
 #include "../include/course.h"
 #include "../include/enrollment.h"
 #include "../include/lock_management.h"
+#include "../include/storage.h"
+#include "../include/wal.h"
+#include "../include/checkpoint.h"
+#include "../include/loader.h"
 
 #ifdef _WIN32
 #include <direct.h>  // to make directory  
@@ -28,6 +32,7 @@ void showMainMenu() {
     printf("3. Student Operations\n");
     printf("4. Course Operations\n");
     printf("5. Enrollment Operations\n");
+    printf("6. Storage Operations\n");
     printf("0. Exit\n");
     printf("Enter your choice: ");
 }
@@ -50,8 +55,24 @@ int main(int argc, char *argv[]) {
     // Initializing all the modules
     printf("Initializing University DBMS...\n");
 
+    // Startup read options: --buffered-reads turns off mapped table reads,
+    // --populate prefaults the mappings instead of faulting pages on demand.
+    // --lock-timeout=MS sets how long row locks wait, 0 waits forever.
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--buffered-reads") == 0) {
+            storageSetReadMode(STORAGE_READ_BUFFERED);
+        } else if (strcmp(argv[i], "--populate") == 0) {
+            storageSetReadMode(STORAGE_READ_MAPPED_POPULATE);
+        } else if (strncmp(argv[i], "--lock-timeout=", 15) == 0) {
+            set_lock_timeout(atoi(argv[i] + 15));
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+        }
+    }
+
     // Initialize the lock table for managing concurrency control
     initialize_lock_table();
+    start_deadlock_detector();
 
     // Create data directory if it doesn't exist
 #ifdef _WIN32
@@ -60,18 +81,13 @@ int main(int argc, char *argv[]) {
     mkdir("data", 0777);
 #endif
 
-    // Initialize all modules (which will load data from files)
+    // Initialize all modules (which will load data from files), the tables
+    // are loaded in parallel
+    loadAllTables();
 
-    initDepartments();
-    printf("Initializing Departments\n");
-    initInstructors();
-    printf("Initializing Instructors\n");
-    initStudents();
-    printf("Initializing Students\n");
-    initCourses();
-    printf("Initializing Courses\n");
-    initEnrollments();
-    printf("Initializing Enrollments\n");
+    // Re-apply changes made since the page files were written
+    walRecover();
+    checkpointStart();
 
     //Concurrency test
     // pthread_t thread1, thread2;
@@ -113,7 +129,14 @@ int main(int argc, char *argv[]) {
             case 5:
                 enrollmentMenu();
                 break;
+            case 6:
+                storageMenu();
+                break;
             case 0:
+                checkpointStop();
+                stop_deadlock_detector();
+                walClose();
+                storageCloseAll();
                 printf("\nThank you for using the University DBMS!\n");
                 exit(0);
                 break;
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "../include/prefix_index.h"
+
+static char *lowerCopy(const char *text) {
+    size_t length = strlen(text);
+    char *copy = malloc(length + 1);
+    if (copy == NULL) return NULL;
+    for (size_t i = 0; i <= length; i++) {
+        copy[i] = (char)tolower((unsigned char)text[i]);
+    }
+    return copy;
+}
+
+static const char *lastKey(const PrefixBlock *block) {
+    return block->entries[block->count - 1].key;
+}
+
+// First block whose last key is >= key (or > key when after is set),
+// blockCount when there is none
+static size_t findBlock(const PrefixIndex *index, const char *key, bool after) {
+    size_t low = 0, high = index->blockCount;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        int order = strcmp(lastKey(index->blocks[middle]), key);
+        if (order < 0 || (after && order == 0)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// First entry of block whose key is >= key (or > key when after is set)
+static size_t findEntry(const PrefixBlock *block, const char *key, bool after) {
+    size_t low = 0, high = block->count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        int order = strcmp(block->entries[middle].key, key);
+        if (order < 0 || (after && order == 0)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Make room for a new block at position
+static bool insertBlock(PrefixIndex *index, size_t position, PrefixBlock *block) {
+    if (index->blockCount == index->blockCapacity) {
+        size_t capacity = index->blockCapacity == 0 ? 4 : index->blockCapacity * 2;
+        PrefixBlock **blocks = realloc(index->blocks, capacity * sizeof(PrefixBlock *));
+        if (blocks == NULL) return false;
+        index->blocks = blocks;
+        index->blockCapacity = capacity;
+    }
+    memmove(&index->blocks[position + 1], &index->blocks[position],
+            (index->blockCount - position) * sizeof(PrefixBlock *));
+    index->blocks[position] = block;
+    index->blockCount++;
+    return true;
+}
+
+static void removeBlock(PrefixIndex *index, size_t position) {
+    free(index->blocks[position]);
+    memmove(&index->blocks[position], &index->blocks[position + 1],
+            (index->blockCount - position - 1) * sizeof(PrefixBlock *));
+    index->blockCount--;
+}
+
+void prefixIndexInit(PrefixIndex *index) {
+    memset(index, 0, sizeof(PrefixIndex));
+}
+
+void prefixIndexFree(PrefixIndex *index) {
+    for (size_t b = 0; b < index->blockCount; b++) {
+        for (size_t i = 0; i < index->blocks[b]->count; i++) {
+            free(index->blocks[b]->entries[i].key);
+        }
+        free(index->blocks[b]);
+    }
+    free(index->blocks);
+    memset(index, 0, sizeof(PrefixIndex));
+}
+
+bool prefixIndexInsert(PrefixIndex *index, const char *key, uintptr_t value) {
+    char *copy = lowerCopy(key);
+    if (copy == NULL) {
+        printf("Error: Memory allocation failed for prefix index key.\n");
+        return false;
+    }
+
+    if (index->blockCount == 0) {
+        PrefixBlock *first = malloc(sizeof(PrefixBlock));
+        if (first == NULL || !insertBlock(index, 0, first)) {
+            printf("Error: Memory allocation failed for prefix index block.\n");
+            free(first);
+            free(copy);
+            return false;
+        }
+        first->count = 0;
+    }
+
+    // Equal keys go after the existing ones. Only a new first block is empty.
+    size_t b = index->blocks[0]->count == 0 ? 0 : findBlock(index, copy, true);
+    if (b == index->blockCount) b--;
+    PrefixBlock *block = index->blocks[b];
+    size_t position = findEntry(block, copy, true);
+
+    // Split a full block, the upper half moves to a new block after it
+    if (block->count == PREFIX_INDEX_BLOCK_SIZE) {
+        PrefixBlock *upper = malloc(sizeof(PrefixBlock));
+        if (upper == NULL || !insertBlock(index, b + 1, upper)) {
+            printf("Error: Memory allocation failed for prefix index block.\n");
+            free(upper);
+            free(copy);
+            return false;
+        }
+        size_t half = PREFIX_INDEX_BLOCK_SIZE / 2;
+        upper->count = block->count - half;
+        memcpy(upper->entries, &block->entries[half], upper->count * sizeof(PrefixEntry));
+        block->count = half;
+
+        if (position > half) {
+            block = upper;
+            position -= half;
+        }
+    }
+
+    memmove(&block->entries[position + 1], &block->entries[position],
+            (block->count - position) * sizeof(PrefixEntry));
+    block->entries[position].key = copy;
+    block->entries[position].value = value;
+    block->count++;
+    index->count++;
+    return true;
+}
+
+bool prefixIndexRemove(PrefixIndex *index, const char *key, uintptr_t value) {
+    char *lowered = lowerCopy(key);
+    if (lowered == NULL) return false;
+
+    // Walk the entries equal to key until the one holding value
+    bool removed = false;
+    size_t b = findBlock(index, lowered, false);
+    size_t position = b < index->blockCount ? findEntry(index->blocks[b], lowered, false) : 0;
+    while (b < index->blockCount && !removed) {
+        PrefixBlock *block = index->blocks[b];
+        for (; position < block->count; position++) {
+            PrefixEntry *entry = &block->entries[position];
+            if (strcmp(entry->key, lowered) != 0) {
+                free(lowered);
+                return false;
+            }
+            if (entry->value == value) {
+                free(entry->key);
+                memmove(entry, entry + 1, (block->count - position - 1) * sizeof(PrefixEntry));
+                block->count--;
+                index->count--;
+                if (block->count == 0) {
+                    removeBlock(index, b);
+                }
+                removed = true;
+                break;
+            }
+        }
+        b++;
+        position = 0;
+    }
+
+    free(lowered);
+    return removed;
+}
+
+size_t prefixIndexSearch(const PrefixIndex *index, const char *prefix, uintptr_t *results, size_t limit) {
+    char *lowered = lowerCopy(prefix);
+    if (lowered == NULL) return 0;
+    size_t length = strlen(lowered);
+
+    size_t found = 0;
+    size_t b = findBlock(index, lowered, false);
+    size_t position = b < index->blockCount ? findEntry(index->blocks[b], lowered, false) : 0;
+    for (; b < index->blockCount && found < limit; b++, position = 0) {
+        const PrefixBlock *block = index->blocks[b];
+        for (; position < block->count && found < limit; position++) {
+            if (strncmp(block->entries[position].key, lowered, length) != 0) {
+                free(lowered);
+                return found;
+            }
+            results[found++] = block->entries[position].value;
+        }
+    }
+
+    free(lowered);
+    return found;
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/ref_index.h"
+
+static RefList *findList(const RefIndex *index, uint64_t key) {
+    uintptr_t value;
+    if (hashIndexFind(&index->lists, key, &value)) {
+        return (RefList *)value;
+    }
+    return NULL;
+}
+
+bool refIndexInit(RefIndex *index, size_t expectedKeys) {
+    index->count = 0;
+    return hashIndexInit(&index->lists, expectedKeys);
+}
+
+void refIndexFree(RefIndex *index) {
+    for (HashIndexCursor cursor = {0}; hashIndexNext(&index->lists, &cursor); ) {
+        RefList *list = (RefList *)cursor.value;
+        free(list->handles);
+        free(list);
+    }
+    hashIndexFree(&index->lists);
+    index->count = 0;
+}
+
+bool refIndexAdd(RefIndex *index, uint64_t key, uintptr_t handle) {
+    RefList *list = findList(index, key);
+    if (list == NULL) {
+        list = calloc(1, sizeof(RefList));
+        if (list == NULL || !hashIndexInsert(&index->lists, key, (uintptr_t)list)) {
+            printf("Error: Memory allocation failed for reference list.\n");
+            free(list);
+            return false;
+        }
+    }
+
+    // Grow the handle array
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity == 0 ? REF_LIST_MIN_CAPACITY : list->capacity * 2;
+        uintptr_t *handles = realloc(list->handles, capacity * sizeof(uintptr_t));
+        if (handles == NULL) {
+            printf("Error: Memory allocation failed for reference list resizing.\n");
+            if (list->count == 0) {
+                hashIndexRemove(&index->lists, key, (uintptr_t)list);
+                free(list);
+            }
+            return false;
+        }
+        list->handles = handles;
+        list->capacity = capacity;
+    }
+
+    list->handles[list->count++] = handle;
+    index->count++;
+    return true;
+}
+
+// The last handle takes the place of the removed one
+bool refIndexRemove(RefIndex *index, uint64_t key, uintptr_t handle) {
+    RefList *list = findList(index, key);
+    if (list == NULL) return false;
+
+    for (size_t i = 0; i < list->count; i++) {
+        if (list->handles[i] == handle) {
+            list->handles[i] = list->handles[--list->count];
+            index->count--;
+
+            if (list->count == 0) {
+                hashIndexRemove(&index->lists, key, (uintptr_t)list);
+                free(list->handles);
+                free(list);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+const RefList *refIndexFind(const RefIndex *index, uint64_t key) {
+    return findList(index, key);
+}
+
+size_t refIndexCount(const RefIndex *index, uint64_t key) {
+    const RefList *list = findList(index, key);
+    return list == NULL ? 0 : list->count;
+}
+
+// Image layout: the header, every list as its length followed by its
+// ordinals (padded to 8 bytes), then an image of the key index whose values
+// are list positions
+typedef struct {
+    uint64_t listCount;
+    uint64_t handleCount;
+} RefIndexImageHeader;
+
+static bool writeOrdinal(FILE *file, uint64_t value) {
+    if (value > UINT32_MAX) return false;
+    uint32_t ordinal = (uint32_t)value;
+    return fwrite(&ordinal, sizeof(ordinal), 1, file) == 1;
+}
+
+bool refIndexWriteImage(const RefIndex *index, FILE *file) {
+    HashIndex positions;
+    bool ok = hashIndexInit(&positions, index->lists.count);
+
+    RefIndexImageHeader header = { index->lists.count, index->count };
+    ok = ok && fwrite(&header, sizeof(header), 1, file) == 1;
+    uintptr_t position = 0;
+    for (HashIndexCursor cursor = {0}; ok && hashIndexNext(&index->lists, &cursor); ) {
+        const RefList *list = (const RefList *)cursor.value;
+        ok = writeOrdinal(file, list->count);
+        for (size_t i = 0; ok && i < list->count; i++) {
+            ok = writeOrdinal(file, list->handles[i]);
+        }
+        ok = ok && hashIndexInsert(&positions, cursor.key, position++);
+    }
+    if (ok && (header.listCount + header.handleCount) % 2 != 0) {
+        ok = writeOrdinal(file, 0);
+    }
+    ok = ok && hashIndexWriteImage(&positions, file);
+    hashIndexFree(&positions);
+    return ok;
+}
+
+size_t refIndexLoadImage(RefIndex *index, const unsigned char *image, size_t size,
+                         const uintptr_t *handles, size_t handleCount) {
+    RefIndexImageHeader header;
+    if (size < sizeof(header)) return 0;
+    memcpy(&header, image, sizeof(header));
+
+    size_t words = (size_t)(header.listCount + header.handleCount);
+    if (header.listCount > header.handleCount || header.handleCount > size ||
+        sizeof(header) + words * sizeof(uint32_t) > size) {
+        return 0;
+    }
+    size_t listBytes = sizeof(header) + (words + words % 2) * sizeof(uint32_t);
+    const uint32_t *ordinals = (const uint32_t *)(image + sizeof(header));
+
+    size_t listCount = (size_t)header.listCount;
+    uintptr_t *lists = calloc(listCount ? listCount : 1, sizeof(uintptr_t));
+    if (lists == NULL) return 0;
+
+    // Rebuild the lists first, the key index then maps to their addresses
+    size_t next = 0;
+    size_t total = 0;
+    bool ok = true;
+    for (size_t l = 0; ok && l < listCount; l++) {
+        size_t count = next < words ? ordinals[next++] : 0;
+        ok = count > 0 && count <= words - next;
+        RefList *list = ok ? malloc(sizeof(RefList)) : NULL;
+        if (list != NULL) {
+            list->handles = malloc(count * sizeof(uintptr_t));
+            list->count = count;
+            list->capacity = count;
+            lists[l] = (uintptr_t)list;
+            ok = list->handles != NULL;
+        } else {
+            ok = false;
+        }
+        for (size_t i = 0; ok && i < count; i++) {
+            uint32_t ordinal = ordinals[next++];
+            ok = ordinal < handleCount;
+            if (ok) list->handles[i] = handles[ordinal];
+        }
+        total += count;
+    }
+
+    size_t used = 0;
+    if (ok && total == header.handleCount) {
+        used = hashIndexLoadImage(&index->lists, image + listBytes, size - listBytes, lists, listCount);
+    }
+    if (used == 0) {
+        for (size_t l = 0; l < listCount; l++) {
+            RefList *list = (RefList *)lists[l];
+            if (list != NULL) free(list->handles);
+            free(list);
+        }
+        free(lists);
+        return 0;
+    }
+    index->count = total;
+    free(lists);
+    return listBytes + used;
+}
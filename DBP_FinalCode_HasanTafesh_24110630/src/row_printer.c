@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include "../include/row_printer.h"
+#include "../include/thread_pool.h"
+
+// One range of the listing and the text formatted for it
+typedef struct {
+    const uintptr_t *rows;
+    size_t count;
+    RowFormat format;
+    char *text;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} RowRange;
+
+static void formatRange(void *arg) {
+    RowRange *range = (RowRange *)arg;
+    for (size_t i = 0; i < range->count && !range->failed; i++) {
+        const void *row = (const void *)range->rows[i];
+        size_t room = range->capacity - range->length;
+        int needed = range->format(range->text + range->length, room, row);
+        if (needed < 0) continue;
+
+        // Grow and format the row again when it did not fit
+        if ((size_t)needed >= room) {
+            size_t capacity = range->capacity * 2;
+            while (capacity - range->length <= (size_t)needed) capacity *= 2;
+            char *text = realloc(range->text, capacity);
+            if (text == NULL) {
+                range->failed = true;
+                break;
+            }
+            range->text = text;
+            range->capacity = capacity;
+            range->format(range->text + range->length, capacity - range->length, row);
+        }
+        range->length += (size_t)needed;
+    }
+}
+
+void printRows(const BTreeIndex *tree, RowFormat format) {
+    size_t count = tree->count;
+    if (count == 0) return;
+
+    uintptr_t *rows = malloc(count * sizeof(uintptr_t));
+    if (rows == NULL) {
+        printf("Error: Memory allocation failed while listing rows.\n");
+        return;
+    }
+    size_t collected = 0;
+    BTreeCursor cursor;
+    btreeIndexSeek(tree, INT_MIN, INT_MAX, &cursor);
+    while (collected < count && btreeIndexNext(&cursor)) {
+        rows[collected++] = cursor.value;
+    }
+
+    // Short listings are formatted right here
+    ThreadPool pool;
+    bool pooled = collected > ROW_PRINTER_RANGE_ROWS && threadPoolInit(&pool, threadPoolDefaultSize());
+    int window = pooled ? pool.threadCount * ROW_PRINTER_RANGES_PER_THREAD : 1;
+    RowRange *ranges = calloc(window, sizeof(RowRange));
+    if (ranges == NULL) {
+        printf("Error: Memory allocation failed while listing rows.\n");
+        if (pooled) threadPoolFree(&pool);
+        free(rows);
+        return;
+    }
+
+    TaskGroup group;
+    taskGroupInit(&group);
+    size_t next = 0;
+    bool failed = false;
+    while (next < collected && !failed) {
+        int used = 0;
+        for (; used < window && next < collected; used++) {
+            RowRange *range = &ranges[used];
+            range->rows = rows + next;
+            range->count = collected - next < ROW_PRINTER_RANGE_ROWS ? collected - next : ROW_PRINTER_RANGE_ROWS;
+            range->format = format;
+            range->length = 0;
+            if (range->text == NULL) {
+                range->text = malloc(ROW_PRINTER_BUFFER_SIZE);
+                range->capacity = range->text != NULL ? ROW_PRINTER_BUFFER_SIZE : 0;
+            }
+            range->failed = range->text == NULL;
+            if (!range->failed) {
+                threadPoolSubmit(pooled ? &pool : NULL, &group, formatRange, range);
+            }
+            next += range->count;
+        }
+        taskGroupWait(&group);
+
+        // Written in order, the buffers are reused by the next window
+        for (int i = 0; i < used && !failed; i++) {
+            failed = ranges[i].failed;
+            if (!failed) fwrite(ranges[i].text, 1, ranges[i].length, stdout);
+        }
+    }
+    fflush(stdout);
+    if (failed) {
+        printf("Error: Memory allocation failed while listing rows.\n");
+    }
+
+    taskGroupDestroy(&group);
+    if (pooled) threadPoolFree(&pool);
+    for (int i = 0; i < window; i++) {
+        free(ranges[i].text);
+    }
+    free(ranges);
+    free(rows);
+}
@@ -0,0 +1,980 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/storage.h"
+#include "../include/wal.h"
+#include "../include/checkpoint.h"
+#include "../include/lock_management.h"
+#include "../include/thread_pool.h"
+#include "../include/text_reader.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define syncFile(file) _commit(_fileno(file))
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define syncFile(file) fsync(fileno(file))
+#define STORAGE_HAVE_MMAP
+#endif
+
+#define SCAN_CHUNK_PAGES 64     // Pages read per fread while scanning
+#define SCAN_RANGES_PER_THREAD 2  // Ranges read ahead per pool thread while scanning
+#define IMPORT_RANGE_BYTES (1 << 20)  // Text parsed per import task
+#define SNAPSHOT_INITIAL_RECORDS 64
+
+// Tables opened by the modules, used by the export and statistics menus
+static StorageTable *openTables[STORAGE_MAX_TABLES];
+static int openTableCount = 0;
+static pthread_mutex_t openTablesMutex = PTHREAD_MUTEX_INITIALIZER;  // Tables open concurrently at startup
+
+// Workers that read page ranges and parse text ranges, NULL to do it inline
+static ThreadPool *loadPool = NULL;
+static StorageReadMode readMode = STORAGE_READ_MAPPED;
+
+// Records are kept 8-byte aligned inside the page
+static size_t recordStride(const StorageTable *table) {
+    return (table->recordSize + 7) & ~(size_t)7;
+}
+
+static void initPage(unsigned char *page) {
+    memset(page, 0, STORAGE_PAGE_SIZE);
+    ((PageHeader *)page)->freeEnd = STORAGE_PAGE_SIZE;
+}
+
+static bool readPage(StorageTable *table, uint32_t pageNo, unsigned char *page) {
+    if (fseek(table->file, (long)pageNo * STORAGE_PAGE_SIZE, SEEK_SET) != 0) return false;
+    return fread(page, STORAGE_PAGE_SIZE, 1, table->file) == 1;
+}
+
+static bool writePage(StorageTable *table, uint32_t pageNo, const unsigned char *page) {
+    if (fseek(table->file, (long)pageNo * STORAGE_PAGE_SIZE, SEEK_SET) != 0) return false;
+    return fwrite(page, STORAGE_PAGE_SIZE, 1, table->file) == 1;
+}
+
+static bool writeHeader(StorageTable *table) {
+    unsigned char page[STORAGE_PAGE_SIZE] = {0};
+    memcpy(page, &table->header, sizeof(StorageHeader));
+    return writePage(table, 0, page);
+}
+
+// Places a record in the page, reusing the space of a deleted slot first.
+// Returns the slot number or -1 when the page is full.
+static int pageInsert(const StorageTable *table, unsigned char *page, const void *record) {
+    PageHeader *header = (PageHeader *)page;
+    size_t stride = recordStride(table);
+
+    for (int i = 0; i < header->slotCount; i++) {
+        if (!(header->slots[i] & STORAGE_SLOT_LIVE)) {
+            memcpy(page + header->slots[i], record, table->recordSize);
+            header->slots[i] |= STORAGE_SLOT_LIVE;
+            header->liveCount++;
+            return i;
+        }
+    }
+
+    size_t directoryEnd = sizeof(PageHeader) + (header->slotCount + 1) * sizeof(uint16_t);
+    if (header->freeEnd < stride || header->freeEnd - stride < directoryEnd) {
+        return -1;
+    }
+
+    header->freeEnd -= stride;
+    memcpy(page + header->freeEnd, record, table->recordSize);
+    header->slots[header->slotCount] = header->freeEnd | STORAGE_SLOT_LIVE;
+    header->liveCount++;
+    return header->slotCount++;
+}
+
+// Appends a record to the tail page, a page is written once it fills up
+static bool appendToTail(StorageTable *table, const void *record) {
+    uint32_t tail = table->header.pageCount - 1;
+
+    if (tail == 0 || pageInsert(table, table->lastPage, record) < 0) {
+        if (tail > 0 && !writePage(table, tail, table->lastPage)) {
+            return false;
+        }
+        initPage(table->lastPage);
+        pageInsert(table, table->lastPage, record);
+        table->header.pageCount++;
+    }
+    table->header.recordCount++;
+    return true;
+}
+
+// Open the page file of a table, importing the text file on first use
+bool storageOpen(StorageTable *table) {
+    table->file = fopen(table->dataPath, "r+b");
+
+    if (table->file == NULL) {
+        table->file = fopen(table->dataPath, "w+b");
+        if (table->file == NULL) {
+            perror("Error creating table page file");
+            return false;
+        }
+
+        table->header.magic = STORAGE_MAGIC;
+        table->header.version = STORAGE_VERSION;
+        table->header.pageSize = STORAGE_PAGE_SIZE;
+        table->header.recordSize = (uint32_t)table->recordSize;
+        table->header.pageCount = 1;
+        table->header.recordCount = 0;
+        if (!writeHeader(table)) {
+            perror("Error writing table page file header");
+            fclose(table->file);
+            table->file = NULL;
+            return false;
+        }
+
+        int imported = storageImportText(table);
+        if (imported > 0) {
+            printf("Imported %d %s record(s) from %s\n", imported, table->name, table->textPath);
+        }
+    } else {
+        unsigned char page[STORAGE_PAGE_SIZE];
+        if (!readPage(table, 0, page)) {
+            printf("Error: Could not read the header of %s.\n", table->dataPath);
+            fclose(table->file);
+            table->file = NULL;
+            return false;
+        }
+        memcpy(&table->header, page, sizeof(StorageHeader));
+
+        if (table->header.magic != STORAGE_MAGIC || table->header.version != STORAGE_VERSION ||
+            table->header.pageSize != STORAGE_PAGE_SIZE ||
+            table->header.recordSize != table->recordSize) {
+            printf("Error: %s has an incompatible format. Remove it to re-import %s.\n",
+                   table->dataPath, table->textPath);
+            fclose(table->file);
+            table->file = NULL;
+            return false;
+        }
+    }
+
+    pthread_mutex_lock(&openTablesMutex);
+    if (openTableCount < STORAGE_MAX_TABLES) {
+        openTables[openTableCount++] = table;
+    }
+    pthread_mutex_unlock(&openTablesMutex);
+    return true;
+}
+
+void storageClose(StorageTable *table) {
+    if (table->file != NULL) {
+        fclose(table->file);
+        table->file = NULL;
+    }
+}
+
+void storageCloseAll() {
+    for (int i = 0; i < openTableCount; i++) {
+        storageClose(openTables[i]);
+    }
+    openTableCount = 0;
+}
+
+StorageTable *storageFindTable(int tableId) {
+    for (int i = 0; i < openTableCount; i++) {
+        if (openTables[i]->tableId == tableId) {
+            return openTables[i];
+        }
+    }
+    return NULL;
+}
+
+// First log segment still needed by any table and the newest checkpoint LSN.
+// Tables that were never checkpointed (segment 0) do not hold back recovery.
+void storageLogPosition(uint32_t *segment, uint64_t *lsn) {
+    *segment = 0;
+    *lsn = 0;
+    for (int i = 0; i < openTableCount; i++) {
+        StorageHeader *header = &openTables[i]->header;
+        if (header->checkpointSegment != 0 &&
+            (*segment == 0 || header->checkpointSegment < *segment)) {
+            *segment = header->checkpointSegment;
+        }
+        if (header->checkpointLsn > *lsn) {
+            *lsn = header->checkpointLsn;
+        }
+    }
+}
+
+void storageSetThreadPool(ThreadPool *pool) {
+    loadPool = pool;
+}
+
+void storageSetReadMode(StorageReadMode mode) {
+    readMode = mode;
+}
+
+// Read-only view of a whole file, read in one pass from front to back
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+} MappedFile;
+
+// Maps the file for a sequential read. False when reads are buffered, the
+// file is empty or the mapping fails; the caller then reads through stdio.
+static bool mapFile(const char *path, MappedFile *mapped) {
+#ifdef STORAGE_HAVE_MMAP
+    if (readMode == STORAGE_READ_BUFFERED) return false;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (readMode == STORAGE_READ_MAPPED_POPULATE) flags |= MAP_POPULATE;
+#endif
+    void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, flags, fd, 0);
+    close(fd);  // The mapping keeps the file referenced
+    if (data == MAP_FAILED) return false;
+
+    // Read-ahead aggressively and drop pages behind the scan early
+    madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+    mapped->data = data;
+    mapped->size = (size_t)info.st_size;
+    return true;
+#else
+    (void)path;
+    (void)mapped;
+    return false;
+#endif
+}
+
+static void unmapFile(MappedFile *mapped) {
+#ifdef STORAGE_HAVE_MMAP
+    munmap((void *)mapped->data, mapped->size);
+#endif
+    mapped->data = NULL;
+    mapped->size = 0;
+}
+
+// A page read from disk is only trusted when its slot directory fits in the
+// page and every slot points at a whole record behind the directory
+static bool pageValid(const StorageTable *table, const unsigned char *page) {
+    const PageHeader *header = (const PageHeader *)page;
+    size_t directoryEnd = sizeof(PageHeader) + (size_t)header->slotCount * sizeof(uint16_t);
+    if (directoryEnd > STORAGE_PAGE_SIZE) return false;
+    for (int s = 0; s < header->slotCount; s++) {
+        size_t offset = header->slots[s] & ~STORAGE_SLOT_LIVE;
+        if (offset < directoryEnd || offset + table->recordSize > STORAGE_PAGE_SIZE) return false;
+    }
+    return true;
+}
+
+// Visits the live records of count pages starting at page firstPage,
+// returns the number visited. Corrupt pages are reported and skipped.
+static int visitPages(const StorageTable *table, const unsigned char *pages, uint32_t firstPage, uint32_t count,
+                      void (*visit)(const void *record, void *ctx), void *ctx) {
+    int visited = 0;
+    for (uint32_t p = 0; p < count; p++) {
+        const unsigned char *page = pages + (size_t)p * STORAGE_PAGE_SIZE;
+        const PageHeader *header = (const PageHeader *)page;
+        if (!pageValid(table, page)) {
+            printf("Error: Page %u of %s is corrupt, its records were skipped.\n",
+                   (unsigned)(firstPage + p), table->dataPath);
+            continue;
+        }
+        for (int s = 0; s < header->slotCount; s++) {
+            if (header->slots[s] & STORAGE_SLOT_LIVE) {
+                visit(page + (header->slots[s] & ~STORAGE_SLOT_LIVE), ctx);
+                visited++;
+            }
+        }
+    }
+    return visited;
+}
+
+// A run of pages read by one scan task through its own file handle
+typedef struct {
+    const StorageTable *table;
+    uint32_t firstPage;
+    uint32_t pageCount;
+    unsigned char *pages;
+    bool failed;
+} ScanRange;
+
+static void readScanRange(void *arg) {
+    ScanRange *range = (ScanRange *)arg;
+    range->pages = malloc((size_t)range->pageCount * STORAGE_PAGE_SIZE);
+    FILE *file = range->pages != NULL ? fopen(range->table->dataPath, "rb") : NULL;
+    range->failed = file == NULL ||
+                    fseek(file, (long)range->firstPage * STORAGE_PAGE_SIZE, SEEK_SET) != 0 ||
+                    fread(range->pages, STORAGE_PAGE_SIZE, range->pageCount, file) != range->pageCount;
+    if (file != NULL) fclose(file);
+}
+
+// Visit every live record of the page file, returns the number visited.
+// Ranges of pages are read ahead on the load pool; the records are visited
+// on the calling thread, in page order.
+int storageScan(StorageTable *table, void (*visit)(const void *record, void *ctx), void *ctx) {
+    if (table->file == NULL) return 0;
+
+    // Mapped, the records are handed out straight from the page cache
+    // instead of being copied into read buffers first
+    MappedFile mapped;
+    if (mapFile(table->dataPath, &mapped)) {
+        uint32_t pages = (uint32_t)(mapped.size / STORAGE_PAGE_SIZE);
+        if (pages < table->header.pageCount) {
+            printf("Error: %s is truncated.\n", table->dataPath);
+        } else {
+            pages = table->header.pageCount;
+        }
+        int visited = pages > 1 ? visitPages(table, mapped.data + STORAGE_PAGE_SIZE, 1, pages - 1, visit, ctx) : 0;
+        unmapFile(&mapped);
+        return visited;
+    }
+
+    int window = loadPool != NULL ? loadPool->threadCount * SCAN_RANGES_PER_THREAD : 1;
+    ScanRange *ranges = calloc(window, sizeof(ScanRange));
+    if (ranges == NULL) {
+        printf("Error: Memory allocation failed while loading %s.\n", table->name);
+        return 0;
+    }
+
+    TaskGroup group;
+    taskGroupInit(&group);
+    int visited = 0;
+    bool truncated = false;
+    uint32_t next = 1;
+    while (next < table->header.pageCount && !truncated) {
+        int used = 0;
+        while (used < window && next < table->header.pageCount) {
+            uint32_t count = table->header.pageCount - next;
+            if (count > SCAN_CHUNK_PAGES) count = SCAN_CHUNK_PAGES;
+            ranges[used].table = table;
+            ranges[used].firstPage = next;
+            ranges[used].pageCount = count;
+            threadPoolSubmit(loadPool, &group, readScanRange, &ranges[used]);
+            next += count;
+            used++;
+        }
+        taskGroupWait(&group);
+
+        for (int i = 0; i < used; i++) {
+            if (ranges[i].failed || truncated) {
+                if (!truncated) printf("Error: %s is truncated.\n", table->dataPath);
+                truncated = true;
+                free(ranges[i].pages);
+                continue;
+            }
+            visited += visitPages(table, ranges[i].pages, ranges[i].firstPage, ranges[i].pageCount,
+                                  visit, ctx);
+            free(ranges[i].pages);
+        }
+    }
+
+    taskGroupDestroy(&group);
+    free(ranges);
+    return visited;
+}
+
+// The image file mapped, or read into memory when it cannot be
+static bool openImage(const char *path, MappedFile *image, bool *copied) {
+    if (mapFile(path, image)) {
+        *copied = false;
+        return true;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    unsigned char *data = size > 0 ? malloc((size_t)size) : NULL;
+    bool ok = data != NULL && fseek(file, 0, SEEK_SET) == 0 &&
+              fread(data, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+    if (!ok) {
+        free(data);
+        return false;
+    }
+    image->data = data;
+    image->size = (size_t)size;
+    *copied = true;
+    return true;
+}
+
+static void closeImage(MappedFile *image, bool copied) {
+    if (copied) {
+        free((void *)image->data);
+        image->data = NULL;
+        image->size = 0;
+    } else {
+        unmapFile(image);
+    }
+}
+
+// Adopted records in page file order, which is the image's ordinal order
+typedef struct {
+    void *(*adopt)(const void *record);
+    uintptr_t *handles;
+    size_t count;
+    size_t capacity;
+} ImageLoad;
+
+static void adoptRecord(const void *record, void *ctx) {
+    ImageLoad *load = ctx;
+    if (load->count == load->capacity) {
+        size_t capacity = load->capacity ? load->capacity * 2 : SNAPSHOT_INITIAL_RECORDS;
+        uintptr_t *handles = realloc(load->handles, capacity * sizeof(uintptr_t));
+        if (handles == NULL) {
+            printf("Error: Memory allocation failed while loading the snapshot image.\n");
+            exit(EXIT_FAILURE);
+        }
+        load->handles = handles;
+        load->capacity = capacity;
+    }
+    load->handles[load->count++] = (uintptr_t)load->adopt(record);
+}
+
+bool storageLoadImage(StorageTable *table, void *(*adopt)(const void *record)) {
+    if (table->imagePath == NULL || table->file == NULL) return false;
+
+    MappedFile image;
+    bool copied;
+    if (!openImage(table->imagePath, &image, &copied)) return false;
+
+    // The image is only used with the page file of the same checkpoint
+    StorageImageHeader header;
+    bool matches = image.size >= sizeof(header);
+    if (matches) {
+        memcpy(&header, image.data, sizeof(header));
+        matches = header.magic == STORAGE_IMAGE_MAGIC && header.version == STORAGE_IMAGE_VERSION &&
+                  header.recordSize == table->recordSize &&
+                  header.recordCount == table->header.recordCount &&
+                  header.pageCount == table->header.pageCount &&
+                  header.checkpointLsn == table->header.checkpointLsn &&
+                  header.indexCount == (uint32_t)(table->imageIndexCount + table->imageRefIndexCount);
+    }
+    if (!matches) {
+        printf("Note: %s is out of date, the %s indexes are rebuilt.\n", table->imagePath, table->name);
+        closeImage(&image, copied);
+        return false;
+    }
+
+    ImageLoad load = { adopt, NULL, 0, 0 };
+    storageScan(table, adoptRecord, &load);
+
+    // Should the records read back differently from what the image was
+    // written for, its hash indexes are rebuilt from the records instead
+    bool intact = load.count == header.recordCount;
+    size_t offset = sizeof(header);
+    for (int i = 0; i < table->imageIndexCount; i++) {
+        HashIndex *index = table->imageIndexes[i];
+        size_t used = intact ? hashIndexLoadImage(index, image.data + offset, image.size - offset,
+                                                  load.handles, load.count) : 0;
+        if (used == 0) {
+            intact = false;
+            hashIndexReserve(index, load.count);
+            for (size_t r = 0; r < load.count; r++) {
+                hashIndexInsert(index, table->imageKey(i, (const void *)load.handles[r]), load.handles[r]);
+            }
+        }
+        offset += used;
+    }
+    for (int i = 0; i < table->imageRefIndexCount; i++) {
+        RefIndex *index = table->imageRefIndexes[i];
+        int keyIndex = table->imageIndexCount + i;
+        size_t used = intact ? refIndexLoadImage(index, image.data + offset, image.size - offset,
+                                                 load.handles, load.count) : 0;
+        if (used == 0) {
+            intact = false;
+            for (size_t r = 0; r < load.count; r++) {
+                refIndexAdd(index, table->imageKey(keyIndex, (const void *)load.handles[r]), load.handles[r]);
+            }
+        }
+        offset += used;
+    }
+    if (!intact) {
+        printf("Warning: %s is damaged, the %s indexes were rebuilt.\n", table->imagePath, table->name);
+    }
+
+    free(load.handles);
+    closeImage(&image, copied);
+    table->imageCurrent = intact;
+    return true;
+}
+
+// True when a table started without a usable snapshot image, so the next
+// checkpoint should run even if nothing was logged
+bool storageImagesOutdated() {
+    for (int i = 0; i < openTableCount; i++) {
+        if (openTables[i]->imagePath != NULL && !openTables[i]->imageCurrent) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Lines of the text file starting inside [start, end), parsed by one task
+typedef struct {
+    const StorageTable *table;
+    const MappedFile *mapped;   // The whole text file, NULL to read it through stdio
+    long start;
+    long end;
+    unsigned char *records;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} ImportRange;
+
+// Parses one line into the range's record buffer, false when it cannot grow
+static bool importLine(ImportRange *range, const char *line, size_t length) {
+    const StorageTable *table = range->table;
+    if (range->count == range->capacity) {
+        size_t capacity = range->capacity ? range->capacity * 2 : SNAPSHOT_INITIAL_RECORDS;
+        unsigned char *records = realloc(range->records, capacity * table->recordSize);
+        if (records == NULL) {
+            range->failed = true;
+            return false;
+        }
+        range->records = records;
+        range->capacity = capacity;
+    }
+    unsigned char *record = range->records + range->count * table->recordSize;
+    memset(record, 0, table->recordSize);
+    if (table->parseText(line, length, record)) {
+        range->count++;
+    }
+    return true;
+}
+
+// A line belongs to the range its first byte is in, so a range skips the
+// end of the previous range's last line and finishes its own last line.
+static void parseMappedRange(ImportRange *range) {
+    const char *data = (const char *)range->mapped->data;
+    const char *fileEnd = data + range->mapped->size;
+    const char *p = data + range->start;
+    const char *end = data + range->end;
+
+    if (range->start > 0 && p[-1] != '\n') {
+        const char *newline = memchr(p, '\n', (size_t)(fileEnd - p));
+        p = newline != NULL ? newline + 1 : fileEnd;
+    }
+    while (p < end) {
+        const char *newline = memchr(p, '\n', (size_t)(fileEnd - p));
+        const char *lineEnd = newline != NULL ? newline : fileEnd;
+        if (!importLine(range, p, (size_t)(lineEnd - p))) break;
+        p = lineEnd + 1;
+    }
+}
+
+static void parseBufferedRange(ImportRange *range) {
+    FILE *text = fopen(range->table->textPath, "rb");
+    TextReader reader;
+    if (text == NULL || fseek(text, range->start > 0 ? range->start - 1 : 0, SEEK_SET) != 0 ||
+        !textReaderInit(&reader, text)) {
+        if (text != NULL) fclose(text);
+        range->failed = true;
+        return;
+    }
+
+    // Reading from the byte before the range, the first line is the end of
+    // the previous range's last line, or empty when the range starts on one
+    char *line;
+    size_t length;
+    if (range->start > 0) {
+        textReaderNextLine(&reader, &line, &length);
+    }
+    while (textReaderOffset(&reader) < range->end && textReaderNextLine(&reader, &line, &length)) {
+        if (!importLine(range, line, length)) break;
+    }
+    textReaderFree(&reader);
+    fclose(text);
+}
+
+static void parseImportRange(void *arg) {
+    ImportRange *range = (ImportRange *)arg;
+    if (range->mapped != NULL) {
+        parseMappedRange(range);
+    } else {
+        parseBufferedRange(range);
+    }
+}
+
+// Append every parsable line of the text file to the page file. The file is
+// split into byte ranges parsed on the load pool, then appended in order.
+int storageImportText(StorageTable *table) {
+    // Mapped, every range parses its lines in place from the page cache
+    MappedFile mapped;
+    bool isMapped = mapFile(table->textPath, &mapped);
+    long size;
+    if (isMapped) {
+        size = (long)mapped.size;
+    } else {
+        FILE *text = fopen(table->textPath, "rb");
+        if (text == NULL) return 0;
+        fseek(text, 0, SEEK_END);
+        size = ftell(text);
+        fclose(text);
+        if (size <= 0) return 0;
+    }
+
+    int rangeCount = (int)((size + IMPORT_RANGE_BYTES - 1) / IMPORT_RANGE_BYTES);
+    ImportRange *ranges = calloc(rangeCount, sizeof(ImportRange));
+    if (ranges == NULL) {
+        printf("Error: Memory allocation failed while importing %s.\n", table->textPath);
+        if (isMapped) unmapFile(&mapped);
+        return 0;
+    }
+
+    TaskGroup group;
+    taskGroupInit(&group);
+    for (int i = 0; i < rangeCount; i++) {
+        ranges[i].table = table;
+        ranges[i].mapped = isMapped ? &mapped : NULL;
+        ranges[i].start = (long)i * IMPORT_RANGE_BYTES;
+        ranges[i].end = i + 1 < rangeCount ? (long)(i + 1) * IMPORT_RANGE_BYTES : size;
+        threadPoolSubmit(loadPool, &group, parseImportRange, &ranges[i]);
+    }
+    taskGroupWait(&group);
+    taskGroupDestroy(&group);
+    if (isMapped) unmapFile(&mapped);
+
+    int imported = 0;
+    for (int i = 0; i < rangeCount; i++) {
+        if (ranges[i].failed) {
+            printf("Error: Could not read part of %s.\n", table->textPath);
+        }
+        for (size_t r = 0; r < ranges[i].count; r++) {
+            if (appendToTail(table, ranges[i].records + r * table->recordSize)) {
+                imported++;
+            }
+        }
+        free(ranges[i].records);
+    }
+    free(ranges);
+
+    if (table->header.pageCount > 1) {
+        writePage(table, table->header.pageCount - 1, table->lastPage);
+    }
+    writeHeader(table);
+    fflush(table->file);
+    return imported;
+}
+
+typedef struct {
+    size_t recordSize;
+    unsigned char *records;
+    uint32_t count;
+    uint32_t capacity;
+    bool failed;
+} Snapshot;
+
+static void snapshotRecord(const void *record, void *ctx) {
+    Snapshot *snapshot = ctx;
+    if (snapshot->failed) return;
+
+    if (snapshot->count == snapshot->capacity) {
+        uint32_t capacity = snapshot->capacity ? snapshot->capacity * 2 : SNAPSHOT_INITIAL_RECORDS;
+        unsigned char *grown = realloc(snapshot->records, (size_t)capacity * snapshot->recordSize);
+        if (grown == NULL) {
+            snapshot->failed = true;
+            return;
+        }
+        snapshot->records = grown;
+        snapshot->capacity = capacity;
+    }
+    memcpy(snapshot->records + (size_t)snapshot->count++ * snapshot->recordSize, record, snapshot->recordSize);
+}
+
+// Builds the table's image indexes over the checkpoint snapshot, with the
+// record ordinals as values, and writes them for the new page file
+static bool writeImage(const StorageTable *table, const Snapshot *snapshot,
+                       const StorageHeader *pageHeader, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return false;
+
+    StorageImageHeader header = {
+        STORAGE_IMAGE_MAGIC, STORAGE_IMAGE_VERSION, (uint32_t)table->recordSize,
+        pageHeader->recordCount, pageHeader->pageCount,
+        (uint32_t)(table->imageIndexCount + table->imageRefIndexCount), pageHeader->checkpointLsn
+    };
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int i = 0; ok && i < table->imageIndexCount; i++) {
+        HashIndex index;
+        ok = hashIndexInit(&index, snapshot->count);
+        for (uint32_t r = 0; ok && r < snapshot->count; r++) {
+            const void *record = snapshot->records + (size_t)r * snapshot->recordSize;
+            ok = hashIndexInsert(&index, table->imageKey(i, record), (uintptr_t)r);
+        }
+        ok = ok && hashIndexWriteImage(&index, file);
+        hashIndexFree(&index);
+    }
+    for (int i = 0; ok && i < table->imageRefIndexCount; i++) {
+        int keyIndex = table->imageIndexCount + i;
+        RefIndex index;
+        ok = refIndexInit(&index, HASH_INDEX_MIN_CAPACITY);
+        for (uint32_t r = 0; ok && r < snapshot->count; r++) {
+            const void *record = snapshot->records + (size_t)r * snapshot->recordSize;
+            ok = refIndexAdd(&index, table->imageKey(keyIndex, record), (uintptr_t)r);
+        }
+        ok = ok && refIndexWriteImage(&index, file);
+        refIndexFree(&index);
+    }
+    ok = ok && fflush(file) == 0 && syncFile(file) == 0;
+    fclose(file);
+    return ok;
+}
+
+// Rewrite the page file from the in-memory table. The table lock is only held
+// while the records are copied out, the file is written after it is released.
+// Changes logged after lsn may or may not be in the copy, redo is idempotent
+// so recovery replays them from segment either way.
+bool storageCheckpoint(StorageTable *table, uint64_t lsn, uint32_t segment) {
+    Snapshot snapshot = { table->recordSize, NULL, 0, 0, false };
+    table->forEachRecord(snapshotRecord, &snapshot);
+    if (snapshot.failed) {
+        printf("Error: Memory allocation failed while checkpointing %s.\n", table->name);
+        free(snapshot.records);
+        return false;
+    }
+
+    // The copy can hold changes logged after lsn that are still only
+    // buffered under the interval and OS policies. They must be durable
+    // before the page file is, or a crash keeps a change the log lost.
+    if (!walFlush()) {
+        printf("Error: Could not sync the log before checkpointing %s.\n", table->name);
+        free(snapshot.records);
+        return false;
+    }
+
+    char tempPath[256];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", table->dataPath);
+
+    StorageTable *image = malloc(sizeof(StorageTable));
+    if (image == NULL) {
+        printf("Error: Memory allocation failed while checkpointing %s.\n", table->name);
+        free(snapshot.records);
+        return false;
+    }
+    *image = *table;
+    image->file = fopen(tempPath, "w+b");
+    if (image->file == NULL) {
+        perror("Error creating checkpoint file");
+        free(snapshot.records);
+        free(image);
+        return false;
+    }
+
+    image->header.pageCount = 1;
+    image->header.recordCount = 0;
+    image->header.checkpointSegment = segment;
+    image->header.checkpointLsn = lsn;
+
+    bool ok = writeHeader(image);
+    for (uint32_t i = 0; ok && i < snapshot.count; i++) {
+        ok = appendToTail(image, snapshot.records + (size_t)i * table->recordSize);
+    }
+    if (ok && image->header.pageCount > 1) {
+        ok = writePage(image, image->header.pageCount - 1, image->lastPage);
+    }
+    ok = ok && writeHeader(image) && fflush(image->file) == 0 && syncFile(image->file) == 0;
+    fclose(image->file);
+
+    // A missing image only costs the next startup an index rebuild
+    char imageTempPath[256];
+    bool imaged = false;
+    if (ok && table->imagePath != NULL) {
+        snprintf(imageTempPath, sizeof(imageTempPath), "%s.tmp", table->imagePath);
+        imaged = writeImage(table, &snapshot, &image->header, imageTempPath);
+        if (!imaged) {
+            printf("Warning: Could not write the snapshot image of %s.\n", table->name);
+            remove(imageTempPath);
+        }
+    }
+    free(snapshot.records);
+
+    if (!ok) {
+        printf("Error: Failed to write checkpoint of %s.\n", table->name);
+        remove(tempPath);
+        free(image);
+        return false;
+    }
+
+    // Swap the new image in, the old file stays valid until the rename
+    storageClose(table);
+#ifdef _WIN32
+    remove(table->dataPath);
+#endif
+    if (rename(tempPath, table->dataPath) != 0) {
+        perror("Error replacing table page file");
+        ok = false;
+        if (imaged) remove(imageTempPath);
+    } else {
+        table->header = image->header;
+
+        // The image goes in after its page file; the old one no longer
+        // matches the page file and is dropped when there is no new one
+        if (table->imagePath != NULL) {
+#ifdef _WIN32
+            remove(table->imagePath);
+#endif
+            table->imageCurrent = imaged && rename(imageTempPath, table->imagePath) == 0;
+            if (!table->imageCurrent) {
+                remove(table->imagePath);
+                if (imaged) remove(imageTempPath);
+            }
+        }
+    }
+    table->file = fopen(table->dataPath, "r+b");
+    free(image);
+    return ok;
+}
+
+bool storageCheckpointAll(uint64_t lsn, uint32_t segment) {
+    bool ok = true;
+    for (int i = 0; i < openTableCount; i++) {
+        ok = storageCheckpoint(openTables[i], lsn, segment) && ok;
+    }
+    return ok;
+}
+
+typedef struct {
+    StorageTable *table;
+    FILE *file;
+    int count;
+} ExportContext;
+
+static void exportRecord(const void *record, void *ctx) {
+    ExportContext *export = ctx;
+    export->table->formatText(export->file, record);
+    export->count++;
+}
+
+// Write the in-memory table to its text file, replacing it atomically
+int storageExportText(StorageTable *table) {
+    char tempPath[256];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", table->textPath);
+
+    FILE *file = fopen(tempPath, "w");
+    if (file == NULL) {
+        perror("Error opening export file");
+        return -1;
+    }
+
+    ExportContext export = { table, file, 0 };
+    table->forEachRecord(exportRecord, &export);
+    fclose(file);
+
+    remove(table->textPath);
+    if (rename(tempPath, table->textPath) != 0) {
+        perror("Error replacing text file");
+        return -1;
+    }
+    return export.count;
+}
+
+void storageExportAll() {
+    for (int i = 0; i < openTableCount; i++) {
+        int count = storageExportText(openTables[i]);
+        if (count >= 0) {
+            printf("Exported %d %s record(s) to %s\n", count, openTables[i]->name, openTables[i]->textPath);
+        }
+    }
+}
+
+void showStorageStatistics() {
+    printf("\n%-20s %10s %10s %12s\n", "Table", "Pages", "Records", "Bytes");
+    for (int i = 0; i < openTableCount; i++) {
+        StorageTable *table = openTables[i];
+        printf("%-20s %10u %10u %12lu\n", table->name, table->header.pageCount,
+               table->header.recordCount,
+               (unsigned long)table->header.pageCount * STORAGE_PAGE_SIZE);
+    }
+    showIndexStatistics();
+    showWalStatistics();
+    showCheckpointStatistics();
+    show_lock_statistics();
+}
+
+// Index occupancy, read under the table lock since the index is walked
+void showIndexStatistics() {
+    printf("\n%-20s %10s %10s %10s %10s\n", "Index", "Entries", "Slots", "Deleted", "Avg Probe");
+    for (int i = 0; i < openTableCount; i++) {
+        StorageTable *table = openTables[i];
+        if (table->index == NULL) continue;
+
+        HashIndexStats stats;
+        acquire_lock(table->tableId, SHARED);
+        hashIndexGetStats(table->index, &stats);
+        release_lock(table->tableId, SHARED);
+
+        printf("%-20s %10lu %10lu %10lu %10.2f\n", table->name, (unsigned long)stats.entries,
+               (unsigned long)stats.capacity, (unsigned long)stats.tombstones, stats.averageProbe);
+    }
+}
+
+void syncPolicyMenu() {
+    int choice;
+    int intervalMs = 0;
+
+    printf("\nLog Sync Policy\n");
+    printf("1. Sync Every Commit\n");
+    printf("2. Sync Every N Milliseconds\n");
+    printf("3. Let the OS Decide\n");
+    printf("Enter choice: ");
+    scanf("%d", &choice);
+    getchar();
+
+    if (choice < 1 || choice > 3) {
+        printf("Invalid choice.\n");
+        return;
+    }
+    if (choice == 2) {
+        printf("Enter interval in milliseconds: ");
+        scanf("%d", &intervalMs);
+        getchar();
+        if (intervalMs <= 0) {
+            printf("Error: Interval must be positive.\n");
+            return;
+        }
+    }
+
+    walSetSyncPolicy((WalSyncPolicy)(choice - 1), intervalMs);
+    printf("Sync policy updated.\n");
+}
+
+void storageMenu() {
+    int choice;
+    do {
+        printf("\nStorage Operations\n");
+        printf("1. Export All Tables to Text Files\n");
+        printf("2. Show Storage Statistics\n");
+        printf("3. Run Checkpoint Now\n");
+        printf("4. Set Log Sync Policy\n");
+        printf("0. Back to Main Menu\n");
+        printf("Enter choice: ");
+
+        scanf("%d", &choice);
+        getchar();
+
+        switch(choice) {
+            case 1:
+                storageExportAll();
+                break;
+            case 2:
+                showStorageStatistics();
+                break;
+            case 3:
+                if (checkpointRun()) {
+                    printf("Checkpoint completed.\n");
+                }
+                break;
+            case 4:
+                syncPolicyMenu();
+                break;
+            case 0:
+                break;
+            default:
+                printf("Invalid choice.\n");
+        }
+    } while (choice != 0);
+}
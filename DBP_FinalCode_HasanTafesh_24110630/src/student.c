@@ -3,79 +3,324 @@
 #include <string.h>
 #include <ctype.h>
 #include <pthread.h>
+#include <limits.h>
 #include "../include/student.h"
 #include "../include/department.h"
 #include "../include/course.h"
 #include "../include/enrollment.h"
 #include "../include/common.h"
 #include "../include/lock_management.h"
+#include "../include/storage.h"
+#include "../include/wal.h"
+#include "../include/hash_index.h"
+#include "../include/text_reader.h"
+#include "../include/row_printer.h"
+
+void removeStudent(Student *student);
+
+// Storage engine callbacks
+void loadStudentRecord(const void *record, void *ctx);
+void *adoptStudentRecord(const void *record);
+uint64_t studentImageKey(int index, const void *record);
+bool parseStudentText(const char *line, size_t length, void *record);
+void formatStudentText(FILE *file, const void *record);
+void forEachStudent(void (*visit)(const void *record, void *ctx), void *ctx);
+void redoStudentLog(int operation, const void *image);
 
 // Global variables
-Student **studentHashTable = NULL; // Dynamic hash table pointer
-StudentNameIdMapping studentNameMapping[NAME_MAPPING_SIZE];
-int studentMappingCount = 0;
+HashIndex studentIndex; // Maps ID to student record
+RefIndex studentsByDepartment; // Maps department ID to its students
+HashIndex studentEmailIndex; // Maps email to student record, unique
+HashIndex studentPhoneIndex; // Maps phone number to student record, unique
+HashIndex studentNameIndex; // Maps (first name, last name) to student records
+PrefixIndex studentNamePrefixIndex; // Full names in order, for prefix searches
 int studentCounter = 0;
-int *studentIdArray;
+BTreeIndex studentIdTree; // Maps ID to student record in ID order
+
+StorageTable studentStorage = {
+    .tableId = STUDENT_TABLE_ID,
+    .name = "Students",
+    .dataPath = "data/Students.db",
+    .textPath = "data/Students.txt",
+    .recordSize = sizeof(Student),
+    .index = &studentIndex,
+    .parseText = parseStudentText,
+    .formatText = formatStudentText,
+    .forEachRecord = forEachStudent,
+    .redoLog = redoStudentLog,
+    .imagePath = "data/Students.idx",
+    .imageIndexes = { &studentIndex, &studentEmailIndex, &studentPhoneIndex, &studentNameIndex },
+    .imageIndexCount = 4,
+    .imageRefIndexes = { &studentsByDepartment },
+    .imageRefIndexCount = 1,
+    .imageKey = studentImageKey,
+};
+
+// Matchers for the email and phone indexes
+static bool studentEmailMatches(uintptr_t value, const void *email) {
+    return strcmp(((Student *)value)->email, (const char *)email) == 0;
+}
+
+static bool studentPhoneMatches(uintptr_t value, const void *phone) {
+    return strcmp(((Student *)value)->phone, (const char *)phone) == 0;
+}
+
+// Key and matcher of the name index, several students may share a name
+typedef struct {
+    const char *firstName;
+    const char *lastName;
+} StudentNameQuery;
+
+static uint64_t studentNameKey(const char *firstName, const char *lastName) {
+    return hashIndexStringKey(firstName) * 31 + hashIndexStringKey(lastName);
+}
 
-// Comparison functions for sorting
-int compareStudentName(const void *a, const void *b) {
-    const StudentNameIdMapping *m1 = (const StudentNameIdMapping *)a;
-    const StudentNameIdMapping *m2 = (const StudentNameIdMapping *)b;
-    int result = strcmp(m1->firstName, m2->firstName);
-    if (result == 0) {
-        return strcmp(m1->lastName, m2->lastName);
+static bool studentNameMatches(uintptr_t value, const void *ctx) {
+    const Student *student = (const Student *)value;
+    const StudentNameQuery *query = (const StudentNameQuery *)ctx;
+    return strcmp(student->firstName, query->firstName) == 0 &&
+           strcmp(student->lastName, query->lastName) == 0;
+}
+
+// "first last", the key of the prefix index
+static void studentFullName(const Student *student, char fullName[], size_t size) {
+    snprintf(fullName, size, "%s %s", student->firstName, student->lastName);
+}
+
+// Add a student to every index, undoing the ones done so far on failure
+static bool indexStudent(Student *student) {
+    uintptr_t handle = (uintptr_t)student;
+    char fullName[sizeof(student->firstName) + sizeof(student->lastName)];
+    studentFullName(student, fullName, sizeof(fullName));
+
+    if (!hashIndexInsert(&studentIndex, (uint64_t)student->id, handle)) {
+        return false;
     }
-    return result;
+    if (!refIndexAdd(&studentsByDepartment, (uint64_t)student->departmentId, handle)) {
+        hashIndexRemove(&studentIndex, (uint64_t)student->id, handle);
+        return false;
+    }
+    if (!hashIndexInsert(&studentEmailIndex, hashIndexStringKey(student->email), handle)) {
+        refIndexRemove(&studentsByDepartment, (uint64_t)student->departmentId, handle);
+        hashIndexRemove(&studentIndex, (uint64_t)student->id, handle);
+        return false;
+    }
+    if (!hashIndexInsert(&studentPhoneIndex, hashIndexStringKey(student->phone), handle)) {
+        hashIndexRemove(&studentEmailIndex, hashIndexStringKey(student->email), handle);
+        refIndexRemove(&studentsByDepartment, (uint64_t)student->departmentId, handle);
+        hashIndexRemove(&studentIndex, (uint64_t)student->id, handle);
+        return false;
+    }
+    if (!hashIndexInsert(&studentNameIndex, studentNameKey(student->firstName, student->lastName), handle)) {
+        hashIndexRemove(&studentPhoneIndex, hashIndexStringKey(student->phone), handle);
+        hashIndexRemove(&studentEmailIndex, hashIndexStringKey(student->email), handle);
+        refIndexRemove(&studentsByDepartment, (uint64_t)student->departmentId, handle);
+        hashIndexRemove(&studentIndex, (uint64_t)student->id, handle);
+        return false;
+    }
+    if (!prefixIndexInsert(&studentNamePrefixIndex, fullName, handle)) {
+        hashIndexRemove(&studentNameIndex, studentNameKey(student->firstName, student->lastName), handle);
+        hashIndexRemove(&studentPhoneIndex, hashIndexStringKey(student->phone), handle);
+        hashIndexRemove(&studentEmailIndex, hashIndexStringKey(student->email), handle);
+        refIndexRemove(&studentsByDepartment, (uint64_t)student->departmentId, handle);
+        hashIndexRemove(&studentIndex, (uint64_t)student->id, handle);
+        return false;
+    }
+    return true;
 }
 
-int compareStudentId(const void *a, const void *b) {
-    return (*(int *)a - *(int *)b);
+static void unindexStudent(Student *student) {
+    uintptr_t handle = (uintptr_t)student;
+    char fullName[sizeof(student->firstName) + sizeof(student->lastName)];
+    studentFullName(student, fullName, sizeof(fullName));
+    hashIndexRemove(&studentIndex, (uint64_t)student->id, handle);
+    refIndexRemove(&studentsByDepartment, (uint64_t)student->departmentId, handle);
+    hashIndexRemove(&studentEmailIndex, hashIndexStringKey(student->email), handle);
+    hashIndexRemove(&studentPhoneIndex, hashIndexStringKey(student->phone), handle);
+    hashIndexRemove(&studentNameIndex, studentNameKey(student->firstName, student->lastName), handle);
+    prefixIndexRemove(&studentNamePrefixIndex, fullName, handle);
 }
 
 // Initialize students
 void initStudents() {
-    // Initialize hash table
-    studentHashTable = calloc(hashTableSize, sizeof(Student *));
-    if (studentHashTable == NULL) {
-        printf("Memory allocation failed for student hash table.\n");
+    // Allocate the hash index
+    if (!hashIndexInit(&studentIndex, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for student hash index.\n");
         exit(EXIT_FAILURE);
     }
+    if (!refIndexInit(&studentsByDepartment, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for student department index.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!hashIndexInit(&studentEmailIndex, HASH_TABLE_SIZE) ||
+        !hashIndexInit(&studentPhoneIndex, HASH_TABLE_SIZE) ||
+        !hashIndexInit(&studentNameIndex, HASH_TABLE_SIZE)) {
+        printf("Memory allocation failed for student email, phone and name indexes.\n");
+        exit(EXIT_FAILURE);
+    }
+    prefixIndexInit(&studentNamePrefixIndex);
 
-    // Initialize ID array
-    studentIdArray = malloc(hashTableSize * sizeof(int));
-    if (studentIdArray == NULL) {
-        printf("Memory allocation failed for student ID array.\n");
+    if (!btreeIndexInit(&studentIdTree)) {
+        printf("Memory allocation failed for student ID tree.\n");
         exit(EXIT_FAILURE);
     }
 
-    for (int i = 0; i < hashTableSize; i++) {
-        studentIdArray[i] = -1;
+    // Load the page file in bulk. The snapshot image of the last checkpoint
+    // brings the hash and reference indexes prebuilt; without one the hash
+    // indexes are sized for every stored row up front. The ID tree is built
+    // once, after the scan.
+    if (storageOpen(&studentStorage)) {
+        btreeIndexBeginBulk(&studentIdTree);
+        if (!storageLoadImage(&studentStorage, adoptStudentRecord)) {
+            size_t rows = studentStorage.header.recordCount;
+            if (!hashIndexReserve(&studentIndex, rows) || !hashIndexReserve(&studentEmailIndex, rows) ||
+                !hashIndexReserve(&studentPhoneIndex, rows) || !hashIndexReserve(&studentNameIndex, rows)) {
+                printf("Memory allocation failed for student indexes.\n");
+                exit(EXIT_FAILURE);
+            }
+            storageScan(&studentStorage, loadStudentRecord, NULL);
+        }
+        if (!btreeIndexEndBulk(&studentIdTree)) {
+            printf("Failed to build the student ID tree.\n");
+            exit(EXIT_FAILURE);
+        }
     }
+}
 
-    // Read from file
-    FILE *file = fopen("data/Students.txt", "r");
-    if (file != NULL) {
-        int id;
-        char firstName[50];
-        char lastName[50];
-        char email[100];
-        char phone[15];
-        int departmentId;
-
-        while (fscanf(file, "%d %s %s %s %s %d\n", &id, firstName, lastName, 
-                     email, phone, &departmentId) != EOF) {
-            Student *student = malloc(sizeof(Student));
-            student->id = id;
-            strncpy(student->firstName, firstName, 50);
-            strncpy(student->lastName, lastName, 50);
-            strncpy(student->email, email, 100);
-            strncpy(student->phone, phone, 15);
-            student->departmentId = departmentId;
-            student->occupied = 1;
-
-            insertStudent(student, true);
+// Drop the students whose department does not exist. The parallel loader
+// runs this once every table is in memory instead of checking each row.
+void checkStudentReferences() {
+    // Read the whole table, other writers stay out so the upgrade below
+    // cannot wait on one
+    acquire_lock(1, SHARED_INTENTION_EXCLUSIVE);
+
+    Student **orphans = malloc((studentCounter + 1) * sizeof(Student *));
+    if (orphans == NULL) {
+        printf("Memory allocation failed while checking student references.\n");
+        release_lock(1, SHARED_INTENTION_EXCLUSIVE);
+        return;
+    }
+    int orphanCount = 0;
+    BTreeCursor cursor;
+    btreeIndexSeek(&studentIdTree, INT_MIN, INT_MAX, &cursor);
+    while (btreeIndexNext(&cursor)) {
+        Student *student = (Student *)cursor.value;
+        if (searchDepartmentById(student->departmentId) == NULL) {
+            orphans[orphanCount++] = student;
         }
-        fclose(file);
+    }
+
+    // Removing changes the indexes, that needs the table to itself
+    LockType held = SHARED_INTENTION_EXCLUSIVE;
+    if (orphanCount > 0) {
+        if (!upgrade_lock(1, held, EXCLUSIVE)) {
+            printf("Error: Students are locked by another user, %d student(s) without a department were kept.\n",
+                   orphanCount);
+            orphanCount = 0;
+        } else {
+            held = EXCLUSIVE;
+        }
+    }
+    for (int i = 0; i < orphanCount; i++) {
+        printf("\nFailed to load student %d. Department %d does not exist.\n",
+               orphans[i]->id, orphans[i]->departmentId);
+        removeStudent(orphans[i]);
+    }
+    free(orphans);
+    release_lock(1, held);
+}
+
+void loadStudentRecord(const void *record, void *ctx) {
+    (void)ctx;
+    Student *student = malloc(sizeof(Student));
+    if (student == NULL) {
+        printf("Memory allocation failed for student entry.\n");
+        return;
+    }
+    memcpy(student, record, sizeof(Student));
+    student->occupied = 1;
+    insertStudent(student, true);
+}
+
+// Loads a student when starting from the snapshot image, which holds every
+// index but the name prefix index and the ID tree
+void *adoptStudentRecord(const void *record) {
+    Student *student = malloc(sizeof(Student));
+    if (student == NULL) {
+        printf("Memory allocation failed for student entry.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(student, record, sizeof(Student));
+    student->occupied = 1;
+
+    uintptr_t handle = (uintptr_t)student;
+    char fullName[sizeof(student->firstName) + sizeof(student->lastName)];
+    studentFullName(student, fullName, sizeof(fullName));
+    if (!prefixIndexInsert(&studentNamePrefixIndex, fullName, handle) ||
+        !btreeIndexInsert(&studentIdTree, student->id, handle)) {
+        printf("Memory allocation failed for student indexes.\n");
+        exit(EXIT_FAILURE);
+    }
+    studentCounter++;
+    return student;
+}
+
+// Keys of the image indexes: studentStorage.imageIndexes, then imageRefIndexes
+uint64_t studentImageKey(int index, const void *record) {
+    const Student *student = (const Student *)record;
+    switch (index) {
+        case 0: return (uint64_t)student->id;
+        case 1: return hashIndexStringKey(student->email);
+        case 2: return hashIndexStringKey(student->phone);
+        case 3: return studentNameKey(student->firstName, student->lastName);
+        default: return (uint64_t)student->departmentId;
+    }
+}
+
+bool parseStudentText(const char *line, size_t length, void *record) {
+    Student *student = (Student *)record;
+    TextFields fields;
+    textFieldsInit(&fields, line, length);
+    if (!textFieldInt(&fields, &student->id) ||
+        !textFieldString(&fields, student->firstName, sizeof(student->firstName)) ||
+        !textFieldString(&fields, student->lastName, sizeof(student->lastName)) ||
+        !textFieldString(&fields, student->email, sizeof(student->email)) ||
+        !textFieldString(&fields, student->phone, sizeof(student->phone)) ||
+        !textFieldInt(&fields, &student->departmentId)) {
+        return false;
+    }
+    student->occupied = 1;
+    return true;
+}
+
+void formatStudentText(FILE *file, const void *record) {
+    const Student *student = (const Student *)record;
+    fprintf(file, "%d %s %s %s %s %d\n",
+            student->id, student->firstName, student->lastName,
+            student->email, student->phone, student->departmentId);
+}
+
+void forEachStudent(void (*visit)(const void *record, void *ctx), void *ctx) {
+    acquire_lock(1, SHARED);
+    BTreeCursor cursor;
+    btreeIndexSeek(&studentIdTree, INT_MIN, INT_MAX, &cursor);
+    while (btreeIndexNext(&cursor)) {
+        visit((const void *)cursor.value, ctx);
+    }
+    release_lock(1, SHARED);
+}
+
+// Replace or remove the student with the logged key
+void redoStudentLog(int operation, const void *image) {
+    int id;
+    memcpy(&id, image, sizeof(int));
+
+    Student *existing = searchStudentById(id);
+    if (existing != NULL) {
+        removeStudent(existing);
+    }
+    if (operation != WAL_DELETE) {
+        loadStudentRecord(image, NULL);
     }
 }
 
@@ -123,100 +368,66 @@ void insertStudent(Student *student, bool isInit) {
     }
 
     // Check for duplicate ID
-    if (bsearch(&(student->id), studentIdArray, studentCounter, sizeof(int), compareStudentId) != NULL) {
+    if (searchStudentById(student->id) != NULL) {
         printf("\nFailed to add student. A student with ID %d already exists.\n", student->id);
         release_lock(1, EXCLUSIVE);
         return;
     }
 
-    // Check department reference
-    if (searchDepartmentById(student->departmentId) == NULL) {
-        printf("\nFailed to add student. Department %d does not exist.\n", student->departmentId);
-        release_lock(1, EXCLUSIVE);
-        return;
-    }
-
-    // Resize hash table if load factor exceeds threshold
-    if ((float)studentCounter / hashTableSize > 0.75) { // Load factor > 0.75
-        int newSize = hashTableSize * 2; // Double the size
-        Student **newHashTable = calloc(newSize, sizeof(Student *));
-        if (newHashTable == NULL) {
-            printf("Error: Memory allocation failed during hash table resizing.\n");
+    // Check department reference, loads check it once all tables are in.
+    // deleteDepartment counts our students while holding its own lock, so
+    // this wait may be aborted to break the deadlock.
+    if (!isInit) {
+        if (!acquire_lock_abortable(3, SHARED)) {
+            printf("\nFailed to add student. Departments are locked by another user, try again.\n");
             release_lock(1, EXCLUSIVE);
             return;
         }
-
-        // Rehash existing entries into the new table
-        for (int i = 0; i < hashTableSize; i++) {
-            if (studentHashTable[i] != NULL && studentHashTable[i]->occupied == 1) {
-                int newIndex = studentHashTable[i]->id % newSize;
-                while (newHashTable[newIndex] != NULL) {
-                    newIndex = (newIndex + 1) % newSize;
-                }
-                newHashTable[newIndex] = studentHashTable[i];
-            }
-        }
-
-        // Free the old table and update the pointer
-        free(studentHashTable);
-        studentHashTable = newHashTable;
-        hashTableSize = newSize; // Update the hash table size
-    }
-
-    // Resize ID array if needed
-    if (studentCounter == hashTableSize) {
-        int *newIdArray = realloc(studentIdArray, hashTableSize * 2 * sizeof(int));
-        if (newIdArray == NULL) {
-            printf("Error: Memory allocation failed for student ID array resizing.\n");
+        bool departmentFound = searchDepartmentById(student->departmentId) != NULL;
+        release_lock(3, SHARED);
+        if (!departmentFound) {
+            printf("\nFailed to add student. Department %d does not exist.\n", student->departmentId);
             release_lock(1, EXCLUSIVE);
             return;
         }
-        studentIdArray = newIdArray;
     }
 
-    // Add ID to array and sort
-    studentIdArray[studentCounter++] = student->id;
-    qsort(studentIdArray, studentCounter, sizeof(int), compareStudentId);
+    // Email and phone are unique. Existing records are loaded as they are.
+    if (!isInit && searchStudentByEmail(student->email) != NULL) {
+        printf("\nFailed to add student. Email %s is already registered.\n", student->email);
+        release_lock(1, EXCLUSIVE);
+        return;
+    }
+    if (!isInit && searchStudentByPhone(student->phone) != NULL) {
+        printf("\nFailed to add student. Phone number %s is already registered.\n", student->phone);
+        release_lock(1, EXCLUSIVE);
+        return;
+    }
 
-    // Insert student into hash table
-    int index = hash(student->id) % hashTableSize;
-    int originalIndex = index;
-    while (studentHashTable[index] != NULL) {
-        if (studentHashTable[index]->occupied == 0) { // Reuse a deleted slot
-            free(studentHashTable[index]);
-            break;
-        }
-        index = (index + 1) % hashTableSize; // Handle collisions with linear probing
-        if (index == originalIndex) { // Full loop
-            printf("Error: Hash table is full. Cannot insert student.\n");
-            release_lock(1, EXCLUSIVE);
-            return;
-        }
+    // Insert into the hash and reference indexes
+    if (!indexStudent(student)) {
+        release_lock(1, EXCLUSIVE);
+        return;
     }
-    studentHashTable[index] = student;
-    studentHashTable[index]->occupied = 1;
+    student->occupied = 1;
 
-    // Add to name mapping
-    if (studentMappingCount < NAME_MAPPING_SIZE) {
-        strncpy(studentNameMapping[studentMappingCount].firstName, student->firstName, 50);
-        strncpy(studentNameMapping[studentMappingCount].lastName, student->lastName, 50);
-        studentNameMapping[studentMappingCount].id = student->id;
-        studentMappingCount++;
-        qsort(studentNameMapping, studentMappingCount, sizeof(StudentNameIdMapping), compareStudentName);
+    // Add to the ordered ID index
+    if (!btreeIndexInsert(&studentIdTree, student->id, (uintptr_t)student)) {
+        unindexStudent(student);
+        student->occupied = 0;
+        release_lock(1, EXCLUSIVE);
+        return;
     }
+    studentCounter++;
 
-    // Store student to file if not during initialization
+    // Log the new student if not during initialization, a student that
+    // cannot be logged would be lost on restart
     if (!isInit) {
-        FILE *file = fopen("data/Students.txt", "a");
-        if (file != NULL) {
-            fprintf(file, "%d %s %s %s %s %d\n",
-                    student->id, student->firstName, student->lastName,
-                    student->email, student->phone, student->departmentId);
-            fflush(file);
-            fclose(file);
-            printf("\nStudent added successfully!\n");
+        if (walLog(&studentStorage, WAL_INSERT, NULL, student) == 0) {
+            printf("\nFailed to add student. The change could not be logged.\n");
+            removeStudent(student);
         } else {
-            perror("Error opening file Students.txt for appending");
+            printf("\nStudent added successfully!\n");
         }
     }
 
@@ -231,33 +442,33 @@ void updateStudent(int id, char *phone) {
 
     Student *student = searchStudentById(id);
     if (student != NULL) {
+        Student *existing = searchStudentByPhone(phone);
+        if (existing != NULL && existing != student) {
+            printf("Error: This phone number is already registered to another student.\n");
+            release_lock(1, EXCLUSIVE);
+            return;
+        }
+
+        Student before = *student;
         strncpy(student->phone, phone, 15);
-        printf("\nPhone number updated successfully.\n");
-        
-        // Update file
-        FILE *file = fopen("data/Students.txt", "r");
-        FILE *temp = fopen("data/Students_temp.txt", "w");
-        
-        if (file != NULL && temp != NULL) {
-            int curr_id;
-            char firstName[50], lastName[50], email[100], curr_phone[15];
-            int departmentId;
-
-            while (fscanf(file, "%d %s %s %s %s %d\n", &curr_id, firstName, lastName, 
-                         email, curr_phone, &departmentId) != EOF) {
-                if (curr_id == id) {
-                    fprintf(temp, "%d %s %s %s %s %d\n", id, firstName, lastName,
-                            email, phone, departmentId);
-                } else {
-                    fprintf(temp, "%d %s %s %s %s %d\n", curr_id, firstName, lastName,
-                            email, curr_phone, departmentId);
-                }
-            }
+        student->phone[14] = '\0';
 
-            fclose(file);
-            fclose(temp);
-            remove("data/Students.txt");
-            rename("data/Students_temp.txt", "data/Students.txt");
+        // Re-key the phone index
+        if (!hashIndexInsert(&studentPhoneIndex, hashIndexStringKey(student->phone), (uintptr_t)student)) {
+            *student = before;
+            release_lock(1, EXCLUSIVE);
+            return;
+        }
+        hashIndexRemove(&studentPhoneIndex, hashIndexStringKey(before.phone), (uintptr_t)student);
+
+        // Log the change instead of rewriting the page file
+        if (walLog(&studentStorage, WAL_UPDATE, &before, student) == 0) {
+            hashIndexInsert(&studentPhoneIndex, hashIndexStringKey(before.phone), (uintptr_t)student);
+            hashIndexRemove(&studentPhoneIndex, hashIndexStringKey(student->phone), (uintptr_t)student);
+            *student = before;
+            printf("Error: The change could not be logged, the phone number was not updated.\n");
+        } else {
+            printf("\nPhone number updated successfully.\n");
         }
     } else {
         printf("Student not found.\n");
@@ -271,101 +482,63 @@ void deleteStudent(int id) {
 
     acquire_lock(1, EXCLUSIVE);
 
-    int index = hash(id);
-    while (studentHashTable[index] != NULL) {
-        if (studentHashTable[index]->occupied && studentHashTable[index]->id == id) {
-            studentHashTable[index]->occupied = 0;
-            printf("\nStudent %s deleted successfully!\n", studentHashTable[index]->firstName);
-
-            // Remove from mapping array
-            for (int i = 0; i < studentMappingCount; i++) {
-                if (studentNameMapping[i].id == id) {
-                    for (int j = i; j < studentMappingCount - 1; j++) {
-                        studentNameMapping[j] = studentNameMapping[j + 1];
-                    }
-                    studentMappingCount--;
-                    break;
-                }
-            }
-
-            // Remove from ID array
-            int *found = bsearch(&id, studentIdArray, studentCounter, sizeof(int), compareStudentId);
-            if (found != NULL) {
-                memmove(found, found + 1, (--studentCounter - (found - studentIdArray)) * sizeof(int));
-            }
-
-            // Update file
-            FILE *file = fopen("data/Students.txt", "r");
-            FILE *temp = fopen("data/Students_temp.txt", "w");
-            
-            if (file != NULL && temp != NULL) {
-                int curr_id;
-                char firstName[50], lastName[50], email[100], phone[15];
-                int departmentId;
-
-                while (fscanf(file, "%d %s %s %s %s %d\n", &curr_id, firstName, lastName, 
-                             email, phone, &departmentId) != EOF) {
-                    if (curr_id != id) {
-                        fprintf(temp, "%d %s %s %s %s %d\n", curr_id, firstName, lastName,
-                                email, phone, departmentId);
-                    }
-                }
-
-                fclose(file);
-                fclose(temp);
-                remove("data/Students.txt");
-                rename("data/Students_temp.txt", "data/Students.txt");
+    Student *student = searchStudentById(id);
+    if (student != NULL) {
+        if (walLog(&studentStorage, WAL_DELETE, student, NULL) == 0) {
+            printf("Error: The change could not be logged, the student was not deleted.\n");
+        } else {
+            printf("\nStudent %s deleted successfully!\n", student->firstName);
+            removeStudent(student);
+        }
+    } else {
+        printf("Student not found.\n");
+    }
 
+    release_lock(1, EXCLUSIVE);
+}
 
-                release_lock(1, EXCLUSIVE);
-            }
+// Remove a student from the indexes and free it.
+void removeStudent(Student *student) {
+    int id = student->id;
+    unindexStudent(student);
 
-            return;
-        }
-        index = hash(index + 1);
+    if (btreeIndexRemove(&studentIdTree, id)) {
+        studentCounter--;
     }
-    printf("Student not found.\n");
-    release_lock(1, EXCLUSIVE);
+
+    free(student);
 }
 
 // Search functions
 Student *searchStudentById(int id) {
-    int index = hash(id);
-    while (studentHashTable[index] != NULL) {
-        if (studentHashTable[index]->occupied && studentHashTable[index]->id == id) {
-            return studentHashTable[index];
-        }
-        index = hash(index + 1);
+    uintptr_t value;
+    if (hashIndexFind(&studentIndex, (uint64_t)id, &value)) {
+        return (Student *)value;
     }
     return NULL;
 }
 
 Student *searchStudentByName(char firstName[], char lastName[]) {
-    for (int i = 0; i < studentMappingCount; i++) {
-        if (strcmp(studentNameMapping[i].firstName, firstName) == 0 &&
-            strcmp(studentNameMapping[i].lastName, lastName) == 0) {
-            return searchStudentById(studentNameMapping[i].id);
-        }
+    StudentNameQuery query = { firstName, lastName };
+    uintptr_t value;
+    if (hashIndexFindMatch(&studentNameIndex, studentNameKey(firstName, lastName), studentNameMatches, &query, &value)) {
+        return (Student *)value;
     }
     return NULL;
 }
 
 Student *searchStudentByEmail(char email[]) {
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (studentHashTable[i] != NULL && studentHashTable[i]->occupied &&
-            strcmp(studentHashTable[i]->email, email) == 0) {
-            return studentHashTable[i];
-        }
+    uintptr_t value;
+    if (hashIndexFindMatch(&studentEmailIndex, hashIndexStringKey(email), studentEmailMatches, email, &value)) {
+        return (Student *)value;
     }
     return NULL;
 }
 
 Student *searchStudentByPhone(char phone[]) {
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (studentHashTable[i] != NULL && studentHashTable[i]->occupied &&
-            strcmp(studentHashTable[i]->phone, phone) == 0) {
-            return studentHashTable[i];
-        }
+    uintptr_t value;
+    if (hashIndexFindMatch(&studentPhoneIndex, hashIndexStringKey(phone), studentPhoneMatches, phone, &value)) {
+        return (Student *)value;
     }
     return NULL;
 }
@@ -374,12 +547,10 @@ void searchStudentsByDepartment(int departmentId) {
     printf("\nStudents in Department %d:\n", departmentId);
     bool found = false;
 
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (studentHashTable[i] != NULL && studentHashTable[i]->occupied &&
-            studentHashTable[i]->departmentId == departmentId) {
-            showStudent(studentHashTable[i]);
-            found = true;
-        }
+    const RefList *list = refIndexFind(&studentsByDepartment, (uint64_t)departmentId);
+    for (size_t i = 0; list != NULL && i < list->count; i++) {
+        showStudent((Student *)list->handles[i]);
+        found = true;
     }
 
 
@@ -388,41 +559,30 @@ void searchStudentsByDepartment(int departmentId) {
     }
 }
 
-// Display functions
-void *printStudent(void *arg) {
-    StudentThreadArg *threadArg = (StudentThreadArg *)arg;
-    Student *student = threadArg->student;
-
+// Students whose "first last" name starts with prefix, ignoring case, in name order
+int searchStudentsByNamePrefix(char prefix[], Student *results[], int limit) {
+    if (limit <= 0) return 0;
 
-    acquire_lock(1, SHARED);
-    printf("ID: %d Name: %s %s Email: %s Phone: %s Department ID: %d\n",
-           student->id, student->firstName, student->lastName,
-           student->email, student->phone, student->departmentId);
+    uintptr_t handles[limit];
+    size_t found = prefixIndexSearch(&studentNamePrefixIndex, prefix, handles, (size_t)limit);
+    for (size_t i = 0; i < found; i++) {
+        results[i] = (Student *)handles[i];
+    }
+    return (int)found;
+}
 
-    release_lock(1, SHARED);
-    return NULL;
+// Display functions
+static int formatStudentRow(char *buffer, size_t size, const void *row) {
+    const Student *student = (const Student *)row;
+    return snprintf(buffer, size, "ID: %d Name: %s %s Email: %s Phone: %s Department ID: %d\n",
+                    student->id, student->firstName, student->lastName,
+                    student->email, student->phone, student->departmentId);
 }
 
 void showAllStudents() {
-
     acquire_lock(1, SHARED);
     printf("\nThere are currently %d student(s) in the database.\n", studentCounter);
-
-    pthread_t threads[studentCounter];
-    StudentThreadArg args[studentCounter];
-    int threadIndex = 0;
-
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (studentHashTable[i] != NULL && studentHashTable[i]->occupied) {
-            args[threadIndex].student = studentHashTable[i];
-            pthread_create(&threads[threadIndex], NULL, printStudent, &args[threadIndex]);
-            threadIndex++;
-        }
-    }
-
-    for (int i = 0; i < threadIndex; i++) {
-        pthread_join(threads[i], NULL);
-    }
+    printRows(&studentIdTree, formatStudentRow);
     release_lock(1, SHARED);
 }
 
@@ -581,6 +741,8 @@ void studentMenu() {
         printf("5. Delete Student\n");
         printf("6. View Student Courses\n");
         printf("7. View Grades\n");
+        printf("8. Find Students by Name Prefix\n");
+        printf("9. Show Students by ID Range\n");
         printf("0. Back to Main Menu\n");
         printf("Enter choice: ");
         
@@ -615,6 +777,26 @@ void studentMenu() {
                     if (student) showStudentGrades(student->id);
                 }
                 break;
+            case 8:
+                {
+                    char prefix[100];
+                    printf("Enter the start of the name: ");
+                    fgets(prefix, sizeof(prefix), stdin);
+                    prefix[strcspn(prefix, "\n")] = 0;
+                    showStudentNameSuggestions(prefix);
+                }
+                break;
+            case 9:
+                {
+                    int firstId, lastId;
+                    printf("Enter first ID: ");
+                    scanf("%d", &firstId);
+                    printf("Enter last ID: ");
+                    scanf("%d", &lastId);
+                    getchar();
+                    showStudentsInIdRange(firstId, lastId);
+                }
+                break;
             case 0:
                 break;
             default:
@@ -628,44 +810,92 @@ void studentMenu() {
 void showStudentCourses(int studentId) {
     acquire_lock(2, SHARED);
 
-    printf("\nCourses for Student %d:\n", studentId);
-
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
+    // The enrollment lists change under row writers, which hold the table
+    // INTENTION_EXCLUSIVE. Second lock, may be aborted to break a deadlock.
+    if (!acquire_lock_abortable(4, SHARED)) {
+        release_lock(2, SHARED);
+        printf("Error: Enrollments are locked by another user, try again.\n");
+        return;
+    }
 
-        if (enrollmentHashTable[i] != NULL && enrollmentHashTable[i]->occupied && enrollmentHashTable[i]->studentId == studentId) {
+    printf("\nCourses for Student %d:\n", studentId);
 
-            Course *course = searchCourseById(enrollmentHashTable[i]->courseId);
-            if (course != NULL) {
-                printf("Course ID: %d\n", course->id);
-                printf("Title: %s\n", course->title);
-                printf("Credits: %d\n", course->credits);
-                printf("Status: %s\n", getStatusString(enrollmentHashTable[i]->status));
-                printf("-------------------------\n");
-            }
+    const RefList *list = refIndexFind(&enrollmentsByStudent, (uint64_t)studentId);
+    for (size_t i = 0; list != NULL && i < list->count; i++) {
+        Enrollment *entry = (Enrollment *)list->handles[i];
+
+        Course *course = searchCourseById(entry->courseId);
+        if (course != NULL) {
+            printf("Course ID: %d\n", course->id);
+            printf("Title: %s\n", course->title);
+            printf("Credits: %d\n", course->credits);
+            printf("Status: %s\n", getStatusString(entry->status));
+            printf("-------------------------\n");
         }
     }
+    release_lock(4, SHARED);
     release_lock(2, SHARED);
 }
 
 void showStudentGrades(int studentId) {
 
     acquire_lock(2, SHARED);
+    if (!acquire_lock_abortable(4, SHARED)) { // Keeps the enrollment lists still
+        release_lock(2, SHARED);
+        printf("Error: Enrollments are locked by another user, try again.\n");
+        return;
+    }
     printf("\nGrades for Student %d:\n", studentId);
 
     
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (enrollmentHashTable[i] != NULL && enrollmentHashTable[i]->occupied &&
-            enrollmentHashTable[i]->studentId == studentId) {
-            Course *course = searchCourseById(enrollmentHashTable[i]->courseId);
-            if (course != NULL) {
-                printf("Course: %s (ID: %d)\n", course->title, course->id);
-                printf("Credits: %d\n", course->credits);
-                printf("Grade: %s\n", enrollmentHashTable[i]->grade);
-                printf("-------------------------\n");
-            }
+    const RefList *list = refIndexFind(&enrollmentsByStudent, (uint64_t)studentId);
+    for (size_t i = 0; list != NULL && i < list->count; i++) {
+        Enrollment *entry = (Enrollment *)list->handles[i];
+        Course *course = searchCourseById(entry->courseId);
+        if (course != NULL) {
+            printf("Course: %s (ID: %d)\n", course->title, course->id);
+            printf("Credits: %d\n", course->credits);
+            printf("Grade: %s\n", entry->grade);
+            printf("-------------------------\n");
         }
     }
 
+    release_lock(4, SHARED);
     release_lock(2, SHARED);
 
 }
+
+void showStudentNameSuggestions(char prefix[]) {
+    Student *results[NAME_SUGGESTION_LIMIT];
+
+    acquire_lock(1, SHARED);
+    int found = searchStudentsByNamePrefix(prefix, results, NAME_SUGGESTION_LIMIT);
+    printf("\nStudents matching \"%s\":\n", prefix);
+    for (int i = 0; i < found; i++) {
+        printf("ID: %d Name: %s %s\n", results[i]->id, results[i]->firstName, results[i]->lastName);
+    }
+    if (found == 0) {
+        printf("No students found.\n");
+    }
+    release_lock(1, SHARED);
+}
+
+// Lists the students with IDs in [firstId, lastId] in ID order
+void showStudentsInIdRange(int firstId, int lastId) {
+    int found = 0;
+
+    acquire_lock(1, SHARED);
+    printf("\nStudents with IDs %d to %d:\n", firstId, lastId);
+    BTreeCursor cursor;
+    btreeIndexSeek(&studentIdTree, firstId, lastId, &cursor);
+    while (btreeIndexNext(&cursor)) {
+        Student *student = (Student *)cursor.value;
+        printf("ID: %d Name: %s %s Department ID: %d\n",
+               student->id, student->firstName, student->lastName, student->departmentId);
+        found++;
+    }
+    if (found == 0) {
+        printf("No students found.\n");
+    }
+    release_lock(1, SHARED);
+}
@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "../include/text_reader.h"
+
+bool textReaderInit(TextReader *reader, FILE *file) {
+    reader->file = file;
+    reader->buffer = malloc(TEXT_READER_BLOCK_SIZE);
+    reader->capacity = reader->buffer != NULL ? TEXT_READER_BLOCK_SIZE : 0;
+    reader->start = 0;
+    reader->length = 0;
+    reader->offset = ftell(file);
+    reader->eof = false;
+    return reader->buffer != NULL;
+}
+
+void textReaderFree(TextReader *reader) {
+    free(reader->buffer);
+    reader->buffer = NULL;
+    reader->capacity = 0;
+}
+
+// Moves the unread tail to the front and reads behind it, growing the
+// buffer when the tail alone fills it
+static bool refill(TextReader *reader) {
+    size_t tail = reader->length - reader->start;
+    if (reader->start > 0) {
+        memmove(reader->buffer, reader->buffer + reader->start, tail);
+        reader->offset += (long)reader->start;
+        reader->start = 0;
+        reader->length = tail;
+    }
+    if (reader->length + 1 >= reader->capacity) {
+        char *grown = realloc(reader->buffer, reader->capacity * 2);
+        if (grown == NULL) return false;
+        reader->buffer = grown;
+        reader->capacity *= 2;
+    }
+
+    // One byte is kept free to terminate a last line without a newline
+    size_t got = fread(reader->buffer + reader->length, 1, reader->capacity - reader->length - 1, reader->file);
+    reader->length += got;
+    if (got == 0) reader->eof = true;
+    return got > 0;
+}
+
+bool textReaderNextLine(TextReader *reader, char **line, size_t *length) {
+    for (;;) {
+        char *begin = reader->buffer + reader->start;
+        size_t available = reader->length - reader->start;
+        char *newline = memchr(begin, '\n', available);
+
+        if (newline != NULL) {
+            *newline = '\0';
+            *line = begin;
+            *length = (size_t)(newline - begin);
+            reader->start += *length + 1;
+            return true;
+        }
+        if (reader->eof || !refill(reader)) {
+            if (available == 0) return false;
+            // Last line without a newline
+            begin = reader->buffer + reader->start;
+            begin[available] = '\0';
+            *line = begin;
+            *length = available;
+            reader->start = reader->length;
+            return true;
+        }
+    }
+}
+
+long textReaderOffset(const TextReader *reader) {
+    return reader->offset + (long)reader->start;
+}
+
+static bool isFieldSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Bounds of the next field, false when the line has no more
+static bool nextField(TextFields *fields, const char **begin, size_t *length) {
+    const char *p = fields->next;
+    while (p < fields->end && isFieldSpace(*p)) p++;
+    if (p == fields->end) {
+        fields->next = p;
+        return false;
+    }
+    const char *q = p;
+    while (q < fields->end && !isFieldSpace(*q)) q++;
+    *begin = p;
+    *length = (size_t)(q - p);
+    fields->next = q;
+    return true;
+}
+
+void textFieldsInit(TextFields *fields, const char *line, size_t length) {
+    fields->next = line;
+    fields->end = line + length;
+}
+
+bool textFieldInt(TextFields *fields, int *value) {
+    const char *p;
+    size_t length;
+    if (!nextField(fields, &p, &length)) return false;
+
+    const char *end = p + length;
+    bool negative = *p == '-';
+    if (*p == '-' || *p == '+') p++;
+    if (p == end) return false;
+
+    // Accumulate negatively so INT_MIN parses too
+    long long result = 0;
+    for (; p < end; p++) {
+        if (*p < '0' || *p > '9') return false;
+        result = result * 10 - (*p - '0');
+        if (result < (long long)INT_MIN) return false;
+    }
+    if (!negative) {
+        if (-result > INT_MAX) return false;
+        result = -result;
+    }
+    *value = (int)result;
+    return true;
+}
+
+bool textFieldString(TextFields *fields, char *dest, size_t size) {
+    const char *p;
+    size_t length;
+    if (!nextField(fields, &p, &length) || length >= size) return false;
+    memcpy(dest, p, length);
+    dest[length] = '\0';
+    return true;
+}
+
+int textFieldsLeft(const TextFields *fields) {
+    TextFields rest = *fields;
+    const char *p;
+    size_t length;
+    int count = 0;
+    while (nextField(&rest, &p, &length)) count++;
+    return count;
+}
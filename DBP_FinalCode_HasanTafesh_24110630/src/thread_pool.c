@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/thread_pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// One worker per online core, within the pool's limit
+int threadPoolDefaultSize() {
+    long cores;
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    cores = (long)info.dwNumberOfProcessors;
+#else
+    cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (cores < 1) cores = 1;
+    if (cores > THREAD_POOL_MAX_THREADS) cores = THREAD_POOL_MAX_THREADS;
+    return (int)cores;
+}
+
+static void finishTask(TaskGroup *group) {
+    pthread_mutex_lock(&group->mutex);
+    if (--group->pending == 0) {
+        pthread_cond_broadcast(&group->done);
+    }
+    pthread_mutex_unlock(&group->mutex);
+}
+
+static void *workerMain(void *arg) {
+    ThreadPool *pool = (ThreadPool *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->head == NULL && !pool->stopping) {
+            pthread_cond_wait(&pool->available, &pool->mutex);
+        }
+        PoolTask *task = pool->head;
+        if (task == NULL) {
+            // Stopping and nothing left to run
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+        pool->head = task->next;
+        if (pool->head == NULL) pool->tail = NULL;
+        pthread_mutex_unlock(&pool->mutex);
+
+        task->run(task->arg);
+        finishTask(task->group);
+        free(task);
+    }
+}
+
+bool threadPoolInit(ThreadPool *pool, int threads) {
+    if (threads < 1) threads = 1;
+    if (threads > THREAD_POOL_MAX_THREADS) threads = THREAD_POOL_MAX_THREADS;
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->available, NULL);
+    pool->head = NULL;
+    pool->tail = NULL;
+    pool->stopping = false;
+    pool->threadCount = 0;
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, workerMain, pool) != 0) {
+            break;
+        }
+        pool->threadCount++;
+    }
+    if (pool->threadCount == 0) {
+        printf("Error: Could not start any worker threads.\n");
+        pthread_cond_destroy(&pool->available);
+        pthread_mutex_destroy(&pool->mutex);
+        return false;
+    }
+    return true;
+}
+
+void threadPoolFree(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->available);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->threadCount; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pool->threadCount = 0;
+    pthread_cond_destroy(&pool->available);
+    pthread_mutex_destroy(&pool->mutex);
+}
+
+void threadPoolSubmit(ThreadPool *pool, TaskGroup *group, void (*run)(void *arg), void *arg) {
+    PoolTask *task = pool != NULL ? malloc(sizeof(PoolTask)) : NULL;
+    if (task == NULL) {
+        run(arg);
+        return;
+    }
+    task->run = run;
+    task->arg = arg;
+    task->group = group;
+    task->next = NULL;
+
+    pthread_mutex_lock(&group->mutex);
+    group->pending++;
+    pthread_mutex_unlock(&group->mutex);
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->tail != NULL) pool->tail->next = task;
+    else pool->head = task;
+    pool->tail = task;
+    pthread_cond_signal(&pool->available);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void taskGroupInit(TaskGroup *group) {
+    pthread_mutex_init(&group->mutex, NULL);
+    pthread_cond_init(&group->done, NULL);
+    group->pending = 0;
+}
+
+void taskGroupWait(TaskGroup *group) {
+    pthread_mutex_lock(&group->mutex);
+    while (group->pending > 0) {
+        pthread_cond_wait(&group->done, &group->mutex);
+    }
+    pthread_mutex_unlock(&group->mutex);
+}
+
+void taskGroupDestroy(TaskGroup *group) {
+    pthread_cond_destroy(&group->done);
+    pthread_mutex_destroy(&group->mutex);
+}
@@ -0,0 +1,492 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "../include/wal.h"
+#include "../include/storage.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define truncateFile(file, size) _chsize(_fileno(file), (long)(size))
+#define syncFile(file) _commit(_fileno(file))
+#else
+#include <unistd.h>
+#define truncateFile(file, size) ftruncate(fileno(file), (off_t)(size))
+#define syncFile(file) fsync(fileno(file))
+#endif
+
+#define WAL_MAX_RECORD (1 << 20)  // Sanity limit while reading a possibly torn log
+#define WAL_BUFFER_LIMIT (1 << 20)  // Flush early when this much is buffered
+
+// Records are appended to the active buffer while the group commit leader
+// writes the other one
+typedef struct {
+    unsigned char *data;
+    size_t used;
+    size_t capacity;
+} WalBuffer;
+
+static FILE *walFile = NULL;
+static uint32_t firstSegment = 1;       // Oldest segment kept on disk
+static uint32_t currentSegment = 1;     // Segment being appended to
+static uint64_t nextLsn = 1;
+static uint64_t walRecordCount = 0;
+static uint64_t walBytes = 0;           // Appended since the last checkpoint began
+static pthread_mutex_t walMutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t crcTable[256];
+
+// Group commit state, protected by walMutex
+static WalBuffer walBuffers[2];
+static WalBuffer *activeBuffer = &walBuffers[0];
+static uint64_t flushedLsn = 0;         // Records up to here reached the file
+static uint64_t syncedLsn = 0;          // Records up to here are on disk
+static bool flushing = false;           // A leader is writing the other buffer
+static bool writeFailed = false;
+static pthread_cond_t flushedCond = PTHREAD_COND_INITIALIZER;
+
+// Sync policy and the interval flusher
+static WalSyncPolicy syncPolicy = WAL_SYNC_EVERY_COMMIT;
+static int syncIntervalMs = WAL_DEFAULT_SYNC_INTERVAL_MS;
+static pthread_t flusherThread;
+static bool flusherRunning = false;
+static pthread_cond_t flusherCond = PTHREAD_COND_INITIALIZER;
+
+// Per policy statistics
+static const char *policyNames[] = { "every commit", "interval", "OS managed" };
+static uint64_t policyCommits[3];
+static uint64_t policySyncs[3];
+static double policySeconds[3];
+static struct timespec policyStart;
+
+static void initCrcTable() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        crcTable[i] = crc;
+    }
+}
+
+static uint32_t crc32Update(uint32_t crc, const void *data, size_t length) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < length; i++) {
+        crc = crcTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static uint32_t recordChecksum(const unsigned char *record, size_t length) {
+    WalRecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    header.checksum = 0;
+
+    uint32_t crc = crc32Update(0xFFFFFFFFu, &header, sizeof(header));
+    crc = crc32Update(crc, record + sizeof(header), length - sizeof(header));
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static void *flusherWorker(void *arg);
+
+static void segmentPath(char *path, size_t size, uint32_t segment) {
+    snprintf(path, size, WAL_SEGMENT_FORMAT, segment);
+}
+
+// Redo the intact records of one segment that are newer than the checkpoint
+// of their table, then cut off a torn tail. Returns the number replayed,
+// damaged tells whether the segment ended in a bad record.
+static int replaySegment(FILE *file, const char *path, bool *damaged) {
+    unsigned char *buffer = NULL;
+    size_t capacity = 0;
+    long validEnd = 0;
+    int replayed = 0;
+    WalRecordHeader header;
+
+    while (fread(&header, sizeof(header), 1, file) == 1) {
+        if (header.length < sizeof(header) || header.length > WAL_MAX_RECORD ||
+            header.beforeSize + header.afterSize != header.length - sizeof(header)) {
+            break;
+        }
+
+        if (header.length > capacity) {
+            unsigned char *grown = realloc(buffer, header.length);
+            if (grown == NULL) break;
+            buffer = grown;
+            capacity = header.length;
+        }
+        memcpy(buffer, &header, sizeof(header));
+        size_t payload = header.length - sizeof(header);
+        if (fread(buffer + sizeof(header), 1, payload, file) != payload ||
+            recordChecksum(buffer, header.length) != header.checksum) {
+            break;
+        }
+
+        StorageTable *table = storageFindTable(header.tableId);
+        if (table != NULL && table->redoLog != NULL && header.lsn > table->header.checkpointLsn) {
+            const unsigned char *image = buffer + sizeof(header);
+            if (header.operation != WAL_DELETE) {
+                image += header.beforeSize;
+            }
+            table->redoLog(header.operation, image);
+            replayed++;
+        }
+
+        if (header.lsn >= nextLsn) nextLsn = header.lsn + 1;
+        validEnd = ftell(file);
+    }
+    free(buffer);
+
+    // Drop a torn record left behind by a crash in the middle of an append
+    fseek(file, 0, SEEK_END);
+    *damaged = ftell(file) != validEnd;
+    if (*damaged) {
+        printf("Warning: Discarding a damaged tail of %s.\n", path);
+        fflush(file);
+        if (truncateFile(file, validEnd) != 0) {
+            perror("Error truncating write-ahead log");
+        }
+    }
+    fseek(file, validEnd, SEEK_SET);
+    walBytes += (uint64_t)validEnd;
+    return replayed;
+}
+
+// Renames the segments following a damaged one out of the way, keeping
+// them for inspection
+static void setAsideSegmentsAfter(uint32_t segment) {
+    char path[64];
+    char damagedPath[80];
+    for (uint32_t later = segment + 1; ; later++) {
+        segmentPath(path, sizeof(path), later);
+        FILE *file = fopen(path, "rb");
+        if (file == NULL) break;
+        fclose(file);
+
+        snprintf(damagedPath, sizeof(damagedPath), "%s.damaged", path);
+        if (rename(path, damagedPath) != 0) {
+            perror("Error setting aside write-ahead log segment");
+            break;
+        }
+        printf("Error: %s follows a damaged segment and was not replayed, it was moved to %s.\n",
+               path, damagedPath);
+    }
+}
+
+// Open the log and redo every record written after the last checkpoint into
+// the in-memory tables. Redo is idempotent, a record replaces or removes the
+// row with its key. Replay stops at the first damaged record, and that
+// segment stays open for appending; otherwise the newest one does.
+// Returns the number of records replayed.
+int walRecover() {
+    initCrcTable();
+
+    uint64_t checkpointLsn;
+    storageLogPosition(&firstSegment, &checkpointLsn);
+    if (firstSegment == 0) firstSegment = 1;
+    nextLsn = checkpointLsn + 1;
+
+    char path[64];
+    int replayed = 0;
+    for (uint32_t segment = firstSegment; ; segment++) {
+        segmentPath(path, sizeof(path), segment);
+        FILE *file = fopen(path, "r+b");
+        if (file == NULL) break;
+
+        bool damaged;
+        replayed += replaySegment(file, path, &damaged);
+        if (walFile != NULL) fclose(walFile);
+        walFile = file;
+        currentSegment = segment;
+
+        // A torn tail is the normal end of the log only in the last segment.
+        // Anything after a bad record would be applied past a gap, so later
+        // segments are set aside and logging continues here.
+        if (damaged) {
+            setAsideSegmentsAfter(segment);
+            break;
+        }
+    }
+
+    if (walFile == NULL) {
+        currentSegment = firstSegment;
+        segmentPath(path, sizeof(path), currentSegment);
+        walFile = fopen(path, "w+b");
+        if (walFile == NULL) {
+            perror("Error creating write-ahead log");
+        }
+    }
+    walRecordCount = replayed;
+    flushedLsn = nextLsn - 1;
+    syncedLsn = flushedLsn;
+    clock_gettime(CLOCK_MONOTONIC, &policyStart);
+    flusherRunning = true;
+    if (pthread_create(&flusherThread, NULL, flusherWorker, NULL) != 0) {
+        printf("Error: Could not start the log flusher thread.\n");
+        flusherRunning = false;
+    }
+
+    if (replayed > 0) {
+        printf("Recovered %d log record(s) from segment(s) %u-%u\n",
+               replayed, firstSegment, currentSegment);
+    }
+    return replayed;
+}
+
+static double secondsSince(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static bool bufferAppend(WalBuffer *buffer, const void *data, size_t length) {
+    if (buffer->used + length > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (capacity < buffer->used + length) capacity *= 2;
+        unsigned char *grown = realloc(buffer->data, capacity);
+        if (grown == NULL) return false;
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->used, data, length);
+    buffer->used += length;
+    return true;
+}
+
+// Write out everything buffered so far as one batch, called with walMutex held
+// and no other flush running. The mutex is released during the write so new
+// commits can fill the other buffer and join the next batch.
+static void flushLocked(bool sync) {
+    WalBuffer *batch = activeBuffer;
+    uint64_t batchLsn = nextLsn - 1;
+    if (batch->used == 0 && (!sync || syncedLsn == batchLsn)) {
+        flushedLsn = batchLsn;
+        return;
+    }
+
+    flushing = true;
+    activeBuffer = (batch == &walBuffers[0]) ? &walBuffers[1] : &walBuffers[0];
+    FILE *file = walFile;
+    pthread_mutex_unlock(&walMutex);
+
+    bool ok = file != NULL &&
+              (batch->used == 0 || fwrite(batch->data, batch->used, 1, file) == 1) &&
+              fflush(file) == 0 && (!sync || syncFile(file) == 0);
+
+    pthread_mutex_lock(&walMutex);
+    if (!ok && !writeFailed) {
+        printf("Error: Failed to write log segment %u.\n", currentSegment);
+        writeFailed = true;
+    }
+    batch->used = 0;
+    flushedLsn = batchLsn;
+    if (sync) {
+        syncedLsn = batchLsn;
+        policySyncs[syncPolicy]++;
+    }
+    flushing = false;
+    pthread_cond_broadcast(&flushedCond);
+}
+
+// Wait for the running flush, then flush whatever is left
+static void flushAllLocked(bool sync) {
+    while (flushing) {
+        pthread_cond_wait(&flushedCond, &walMutex);
+    }
+    flushLocked(sync);
+}
+
+// Append a change to the log, the caller holds the table's exclusive lock or
+// the row's. Appends from several row lockers are ordered by walMutex.
+// Under WAL_SYNC_EVERY_COMMIT the call returns once the record is on disk;
+// concurrent commits share one write and fsync, the first waiter leads.
+// Returns the LSN of the record or 0 when the append failed.
+uint64_t walLog(StorageTable *table, WalOperation operation, const void *before, const void *after) {
+    WalRecordHeader header = {0};
+    header.tableId = (uint16_t)table->tableId;
+    header.operation = (uint16_t)operation;
+    header.beforeSize = before != NULL ? (uint32_t)table->recordSize : 0;
+    header.afterSize = after != NULL ? (uint32_t)table->recordSize : 0;
+    header.length = (uint32_t)(sizeof(header) + header.beforeSize + header.afterSize);
+
+    unsigned char *record = malloc(header.length);
+    if (record == NULL) {
+        printf("Error: Memory allocation failed for log record.\n");
+        return 0;
+    }
+
+    pthread_mutex_lock(&walMutex);
+
+    header.lsn = nextLsn;
+    memcpy(record, &header, sizeof(header));
+    if (before != NULL) memcpy(record + sizeof(header), before, header.beforeSize);
+    if (after != NULL) memcpy(record + sizeof(header) + header.beforeSize, after, header.afterSize);
+    header.checksum = recordChecksum(record, header.length);
+    memcpy(record, &header, sizeof(header));
+
+    if (writeFailed || walFile == NULL || !bufferAppend(activeBuffer, record, header.length)) {
+        printf("Error: Failed to append to log segment %u.\n", currentSegment);
+        pthread_mutex_unlock(&walMutex);
+        free(record);
+        return 0;
+    }
+
+    uint64_t lsn = nextLsn++;
+    walRecordCount++;
+    walBytes += header.length;
+    policyCommits[syncPolicy]++;
+
+    if (syncPolicy == WAL_SYNC_EVERY_COMMIT) {
+        while (syncedLsn < lsn) {
+            if (flushing) {
+                pthread_cond_wait(&flushedCond, &walMutex);
+            } else {
+                flushLocked(true);
+            }
+        }
+    } else if (syncPolicy == WAL_SYNC_OS || activeBuffer->used >= WAL_BUFFER_LIMIT) {
+        // Hand the record to the OS, it decides when to write it back
+        if (!flushing) flushLocked(false);
+    }
+    if (writeFailed) lsn = 0;
+
+    pthread_mutex_unlock(&walMutex);
+    free(record);
+    return lsn;
+}
+
+// Syncs the buffered records every syncIntervalMs under WAL_SYNC_INTERVAL
+static void *flusherWorker(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&walMutex);
+    while (flusherRunning) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)(syncPolicy == WAL_SYNC_INTERVAL ? syncIntervalMs : 1000) * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&flusherCond, &walMutex, &deadline);
+
+        if (flusherRunning && syncPolicy == WAL_SYNC_INTERVAL && !flushing && syncedLsn < nextLsn - 1) {
+            flushLocked(true);
+        }
+    }
+    pthread_mutex_unlock(&walMutex);
+    return NULL;
+}
+
+void walSetSyncPolicy(WalSyncPolicy policy, int intervalMs) {
+    pthread_mutex_lock(&walMutex);
+    policySeconds[syncPolicy] += secondsSince(&policyStart);
+    clock_gettime(CLOCK_MONOTONIC, &policyStart);
+
+    // Records accepted under the old policy keep its guarantee
+    flushAllLocked(syncPolicy != WAL_SYNC_OS);
+    syncPolicy = policy;
+    if (intervalMs > 0) syncIntervalMs = intervalMs;
+    pthread_cond_signal(&flusherCond);
+    pthread_mutex_unlock(&walMutex);
+}
+
+// Write and sync every record appended so far, whatever the sync policy.
+// A checkpoint calls this before it writes records copied from memory, so
+// the page file never holds a change the log could still lose.
+bool walFlush() {
+    pthread_mutex_lock(&walMutex);
+    flushAllLocked(true);
+    bool ok = !writeFailed;
+    pthread_mutex_unlock(&walMutex);
+    return ok;
+}
+
+// Switch to a new segment and return the LSN every table image written from
+// now on will contain. Records in older segments are no longer needed once
+// all tables are checkpointed, see walRemoveSegments.
+bool walBeginCheckpoint(uint64_t *lsn, uint32_t *segment) {
+    char path[64];
+    bool ok = false;
+
+    pthread_mutex_lock(&walMutex);
+
+    // The old segment must be complete before it is sealed
+    flushAllLocked(true);
+
+    segmentPath(path, sizeof(path), currentSegment + 1);
+    FILE *file = fopen(path, "w+b");
+    if (file == NULL) {
+        perror("Error creating write-ahead log segment");
+    } else {
+        if (walFile != NULL) fclose(walFile);
+        walFile = file;
+        currentSegment++;
+        walBytes = 0;
+        *lsn = nextLsn - 1;
+        *segment = currentSegment;
+        ok = true;
+    }
+    pthread_mutex_unlock(&walMutex);
+    return ok;
+}
+
+// Delete the segments before segment
+void walRemoveSegments(uint32_t segment) {
+    char path[64];
+
+    pthread_mutex_lock(&walMutex);
+    while (firstSegment < segment && firstSegment < currentSegment) {
+        segmentPath(path, sizeof(path), firstSegment);
+        if (remove(path) != 0) {
+            perror("Error removing write-ahead log segment");
+        }
+        firstSegment++;
+    }
+    pthread_mutex_unlock(&walMutex);
+}
+
+// Bytes appended since the last checkpoint began
+uint64_t walPendingBytes() {
+    pthread_mutex_lock(&walMutex);
+    uint64_t bytes = walBytes;
+    pthread_mutex_unlock(&walMutex);
+    return bytes;
+}
+
+void walClose() {
+    pthread_mutex_lock(&walMutex);
+    bool joinFlusher = flusherRunning;
+    flusherRunning = false;
+    pthread_cond_signal(&flusherCond);
+    pthread_mutex_unlock(&walMutex);
+    if (joinFlusher) {
+        pthread_join(flusherThread, NULL);
+    }
+
+    pthread_mutex_lock(&walMutex);
+    flushAllLocked(true);
+    if (walFile != NULL) {
+        fclose(walFile);
+        walFile = NULL;
+    }
+    pthread_mutex_unlock(&walMutex);
+}
+
+void showWalStatistics() {
+    pthread_mutex_lock(&walMutex);
+    printf("\nWrite-ahead log segments: %u-%u\n", firstSegment, currentSegment);
+    printf("Next LSN: %llu\n", (unsigned long long)nextLsn);
+    printf("Records: %llu\n", (unsigned long long)walRecordCount);
+    printf("Bytes since checkpoint: %llu\n", (unsigned long long)walBytes);
+    printf("Sync policy: %s", policyNames[syncPolicy]);
+    if (syncPolicy == WAL_SYNC_INTERVAL) printf(" (%d ms)", syncIntervalMs);
+    printf("\n");
+
+    printf("\n%-14s %10s %10s %12s %14s\n", "Policy", "Commits", "Syncs", "Commits/sync", "Commits/sec");
+    for (int i = 0; i < 3; i++) {
+        double seconds = policySeconds[i] + (i == (int)syncPolicy ? secondsSince(&policyStart) : 0);
+        printf("%-14s %10llu %10llu %12.1f %14.1f\n", policyNames[i],
+               (unsigned long long)policyCommits[i], (unsigned long long)policySyncs[i],
+               policySyncs[i] ? (double)policyCommits[i] / policySyncs[i] : 0.0,
+               seconds > 0 ? policyCommits[i] / seconds : 0.0);
+    }
+    pthread_mutex_unlock(&walMutex);
+}